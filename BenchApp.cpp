@@ -0,0 +1,32 @@
+#include <Urho3D/Engine/Engine.h>
+
+#include "BenchApp.h"
+#include "GameLog.h"
+
+BenchApp::BenchApp(Context* context) :
+	MainScene(context)
+{
+}
+
+void BenchApp::Setup()
+{
+	MainScene::Setup();
+
+	// Results go to stdout, the log only to its file
+	engineParameters_["Headless"] = true;
+	engineParameters_["Sound"] = false;
+	engineParameters_["LogQuiet"] = true;
+}
+
+void BenchApp::Start()
+{
+	// Only what the segment generation and the physics need
+	gameLog_ = new GameLog(context_);
+	CreateSystems();
+	CreateScene();
+	CreateCharacter();
+
+	RunBenches();
+
+	engine_->Exit();
+}
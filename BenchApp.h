@@ -0,0 +1,25 @@
+#pragma once
+
+#include "BenchSettings.h"
+#include "MainScene.h"
+
+/// Base of the headless benchmarks.
+/// Sets up an engine without window, audio or input, builds the game's systems, scene and character without UI, input
+/// handling or saves, runs the benchmarks of the subclass and exits.
+class BenchApp : public MainScene
+{
+	URHO3D_OBJECT(BenchApp, MainScene);
+
+public:
+	/// Construct.
+	BenchApp(Context* context);
+
+	/// Set up a headless engine.
+	virtual void Setup();
+	/// Build the scene, run the benchmarks and exit.
+	virtual void Start();
+
+protected:
+	/// Run the benchmarks.
+	virtual void RunBenches() = 0;
+};
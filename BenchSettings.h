@@ -0,0 +1,6 @@
+#pragma once
+
+/// Seed the benchmarks generate their segments from.
+const unsigned BENCH_SEED = 12345;
+/// Simulated frame time of the benchmarks, in seconds.
+const float BENCH_TIME_STEP = 1.0f / 60.0f;
@@ -0,0 +1,142 @@
+#include <Urho3D/Math/Ray.h>
+#include <Urho3D/Physics/CollisionShape.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "CameraCollision.h"
+
+/// Collision layer bit of the world scenery the camera stays out of.
+static const unsigned CAMERA_COLLISION_MASK = 2;
+/// Direction change, as a dot product, under which the last collision result is reused.
+static const float CAMERA_REUSE_DOT = 0.9998f;
+
+CameraCollision::CameraCollision(Context* context) :
+	Object(context),
+	segmentLength_(100.0f),
+	segmentIndex_(M_MIN_INT),
+	lastMaxDistance_(0.0f),
+	lastHitDistance_(0.0f),
+	distance_(0.0f),
+	hasQuery_(false),
+	statsTimer_(0.0f),
+	queriesSaved_(0),
+	queriesSavedLastSecond_(0)
+{
+}
+
+CameraCollision::~CameraCollision()
+{
+}
+
+void CameraCollision::SetSegments(Node* segments, float segmentLength)
+{
+	segments_ = segments;
+	segmentLength_ = segmentLength;
+	segment_.Reset();
+	segmentIndex_ = M_MIN_INT;
+	colliders_.Clear();
+	hasQuery_ = false;
+}
+
+float CameraCollision::Update(const Vector3& aimPoint, const Vector3& direction, float distance, float timeStep)
+{
+	statsTimer_ += timeStep;
+	if (statsTimer_ >= 1.0f)
+	{
+		queriesSavedLastSecond_ = queriesSaved_;
+		queriesSaved_ = 0;
+		statsTimer_ = 0.0f;
+	}
+
+	UpdateColliders(aimPoint);
+
+	// Nothing in the corridor moves, so a query from nearly the same place in nearly the same direction gives the same
+	// answer
+	if (hasQuery_ && distance == lastMaxDistance_ && (aimPoint - lastAimPoint_).LengthSquared() <
+		CAMERA_REUSE_DISTANCE * CAMERA_REUSE_DISTANCE && direction.DotProduct(lastDirection_) > CAMERA_REUSE_DOT)
+		++queriesSaved_;
+	else
+	{
+		lastHitDistance_ = Query(aimPoint, direction, distance);
+		lastAimPoint_ = aimPoint;
+		lastDirection_ = direction;
+		lastMaxDistance_ = distance;
+		if (!hasQuery_)
+			distance_ = lastHitDistance_;
+		hasQuery_ = true;
+	}
+
+	// Pull in at once so the camera never ends up inside a wall, move back out smoothly
+	if (lastHitDistance_ < distance_)
+		distance_ = lastHitDistance_;
+	else
+		distance_ += (lastHitDistance_ - distance_) * Min(timeStep * CAMERA_RETURN_SPEED, 1.0f);
+
+	return distance_;
+}
+
+void CameraCollision::UpdateColliders(const Vector3& aimPoint)
+{
+	Node* segments = segments_;
+	if (!segments)
+		return;
+
+	// Look the segment up only when the aim point moves into another one. Segments are built well ahead of the
+	// character, the one the aim point is in already exists
+	int index = FloorToInt(aimPoint.z_ / segmentLength_);
+	if (index == segmentIndex_)
+		return;
+
+	Node* segment = segments->GetChild("Segment" + String(index));
+	segment_ = segment;
+	segmentIndex_ = index;
+	colliders_.Clear();
+	if (!segment)
+		return;
+
+	const Vector<SharedPtr<Node> >& children = segment->GetChildren();
+	for (unsigned i = 0; i < children.Size(); ++i)
+	{
+		Node* child = children[i];
+		RigidBody* body = child->GetComponent<RigidBody>();
+		CollisionShape* shape = child->GetComponent<CollisionShape>();
+		if (!body || !shape || !(body->GetCollisionLayer() & CAMERA_COLLISION_MASK) || shape->GetShapeType() != SHAPE_BOX)
+			continue;
+
+		Vector3 halfSize = shape->GetSize() * 0.5f;
+		BoundingBox box(shape->GetPosition() - halfSize, shape->GetPosition() + halfSize);
+		box = box.Transformed(child->GetWorldTransform());
+		box.min_ -= Vector3::ONE * CAMERA_COLLISION_RADIUS;
+		box.max_ += Vector3::ONE * CAMERA_COLLISION_RADIUS;
+		colliders_.Push(box);
+	}
+}
+
+float CameraCollision::Query(const Vector3& aimPoint, const Vector3& direction, float maxDistance)
+{
+	Ray ray(aimPoint, direction);
+
+	// Outside the segments, for example before the start of the track, fall back to the physics world
+	if (!segment_)
+	{
+		Node* segments = segments_;
+		PhysicsWorld* physicsWorld = segments ? physicsWorld_.Get(segments->GetScene()) : 0;
+		if (!physicsWorld)
+			return maxDistance;
+
+		PhysicsRaycastResult result;
+		physicsWorld->SphereCast(result, ray, CAMERA_COLLISION_RADIUS, maxDistance, CAMERA_COLLISION_MASK);
+		return result.body_ ? Min(result.distance_, maxDistance) : maxDistance;
+	}
+
+	float hitDistance = maxDistance;
+	for (unsigned i = 0; i < colliders_.Size(); ++i)
+	{
+		// A box the aim point is inside of gives zero, the sweep starts in it and is not blocked by it
+		float boxDistance = ray.HitDistance(colliders_[i]);
+		if (boxDistance > 0.0f && boxDistance < hitDistance)
+			hitDistance = boxDistance;
+	}
+	return hitDistance;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Math/BoundingBox.h>
+
+#include "ComponentRef.h"
+
+namespace Urho3D
+{
+	class PhysicsWorld;
+}
+
+using namespace Urho3D;
+
+/// Radius of the sphere swept from the aim point towards the camera.
+const float CAMERA_COLLISION_RADIUS = 0.3f;
+/// Aim point movement under which the last collision result is reused.
+const float CAMERA_REUSE_DISTANCE = 0.25f;
+/// Rate at which the camera moves back out after a collision, per second.
+const float CAMERA_RETURN_SPEED = 4.0f;
+
+/// Third person camera collision.
+/// A sphere is swept from the aim point back towards the camera against the box colliders of the segment the aim point
+/// is in. Floor and wall boxes are axis aligned, so the sweep is a ray test against the boxes grown by the radius; they
+/// are collected once per segment. While the aim point and direction hardly move, the last result is reused. The
+/// camera pulls in at once on a hit and moves back out smoothly.
+class CameraCollision : public Object
+{
+	URHO3D_OBJECT(CameraCollision, Object);
+
+public:
+	/// Construct.
+	CameraCollision(Context* context);
+	/// Destruct.
+	~CameraCollision();
+
+	/// Set the parent node of the segments and the segment length. Call again when the segments are rebuilt.
+	void SetSegments(Node* segments, float segmentLength);
+	/// Return the camera distance for this frame given the aim point, the direction from it to the camera and the
+	/// wanted distance.
+	float Update(const Vector3& aimPoint, const Vector3& direction, float distance, float timeStep);
+
+	/// Return number of queries saved by reusing a result during the last second.
+	unsigned GetQueriesSaved() const { return queriesSavedLastSecond_; }
+
+private:
+	/// Collect the collider boxes of the segment the aim point is in, if it changed.
+	void UpdateColliders(const Vector3& aimPoint);
+	/// Return hit distance of the swept sphere, or the maximum distance if nothing is hit.
+	float Query(const Vector3& aimPoint, const Vector3& direction, float maxDistance);
+
+	/// Parent node of the segments.
+	WeakPtr<Node> segments_;
+	/// Segment length.
+	float segmentLength_;
+	/// Segment the colliders are from.
+	WeakPtr<Node> segment_;
+	/// Index of the segment the colliders are from.
+	int segmentIndex_;
+	/// Collider boxes grown by the sphere radius.
+	PODVector<BoundingBox> colliders_;
+	/// Physics world, for aim points outside any segment.
+	ComponentRef<PhysicsWorld> physicsWorld_;
+	/// Aim point of the last query.
+	Vector3 lastAimPoint_;
+	/// Direction of the last query.
+	Vector3 lastDirection_;
+	/// Wanted distance of the last query.
+	float lastMaxDistance_;
+	/// Hit distance of the last query.
+	float lastHitDistance_;
+	/// Smoothed camera distance.
+	float distance_;
+	/// Whether a query has been made.
+	bool hasQuery_;
+	/// Time since the saved queries were last counted.
+	float statsTimer_;
+	/// Queries saved during the current second.
+	unsigned queriesSaved_;
+	/// Queries saved during the last full second.
+	unsigned queriesSavedLastSecond_;
+};
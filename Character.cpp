@@ -1,5 +1,3 @@
-#include <iostream>
-
 #include <Urho3D/Core/Context.h>
 #include <Urho3D/Graphics/AnimationController.h>
 #include <Urho3D/IO/MemoryBuffer.h>
@@ -18,6 +16,12 @@
 #include <Urho3D/UI/Window.h>
 
 #include "Character.h"
+#include "GameLog.h"
+#include "InputQueue.h"
+#include "LatencyTracer.h"
+#include "RunSnapshot.h"
+#include "Touch.h"
+#include "TraceProfiler.h"
 
 Character::Character(Context* context) :
 	LogicComponent(context),
@@ -56,15 +60,106 @@ void Character::Start()
 {
 	// Component has been inserted into its scene node. Subscribe to events now
 	SubscribeToEvent(GetNode(), E_NODECOLLISION, URHO3D_HANDLER(Character, HandleNodeCollision));
+
+	// The animation controller is created before the character, the state machine keeps it from here on
+	animation_.Init(GetComponent<AnimationController>(), GetSubsystem<ResourceCache>());
 }
 
-void Character::FixedUpdate(float timeStep)
+void Character::Reset(const Vector3& position)
 {
-	RigidBody* body = GetComponent<RigidBody>();
+	node_->SetPosition(position);
+	node_->SetRotation(Quaternion::IDENTITY);
 
-	/// \todo Could cache the components for faster access instead of finding them each frame
+	RigidBody* body = body_.Get(node_);
+	if (body)
+	{
+		body->SetLinearVelocity(Vector3::ZERO);
+		body->SetAngularVelocity(Vector3::ZERO);
+		body->ResetForces();
+		body->Activate();
+	}
 
-	AnimationController* animCtrl = GetComponent<AnimationController>();
+	animation_.Reset();
+
+	controls_.Reset();
+	if (inputQueue_)
+		inputQueue_->Clear();
+	if (touch_)
+		touch_->ClearGestures();
+	gameOver_ = false;
+	playCollectSound_ = false;
+	collected_ = 0;
+	speed_ = 1.0f;
+	onGround_ = false;
+	okToJump_ = true;
+	inAirTimer_ = 0.0f;
+	onLeftLane_ = false;
+	onMiddleLane_ = true;
+	onRightLane_ = false;
+}
+
+void Character::GetState(CharacterState& state) const
+{
+	state.position_ = node_->GetPosition();
+	state.rotation_ = node_->GetRotation();
+	RigidBody* body = body_.Get(node_);
+	state.linearVelocity_ = body ? body->GetLinearVelocity() : Vector3::ZERO;
+	state.speed_ = speed_;
+	state.collected_ = collected_;
+	state.onGround_ = onGround_;
+	state.okToJump_ = okToJump_;
+	state.inAirTimer_ = inAirTimer_;
+}
+
+void Character::SetState(const CharacterState& state)
+{
+	Reset(state.position_);
+	node_->SetRotation(state.rotation_);
+
+	RigidBody* body = body_.Get(node_);
+	if (body)
+		body->SetLinearVelocity(state.linearVelocity_);
+
+	speed_ = state.speed_;
+	collected_ = state.collected_;
+	onGround_ = state.onGround_;
+	okToJump_ = state.okToJump_;
+	inAirTimer_ = state.inAirTimer_;
+}
+
+void Character::SetTouch(Touch* touch)
+{
+	touch_ = touch;
+}
+
+void Character::SetLatencyTracer(LatencyTracer* tracer)
+{
+	latencyTracer_ = tracer;
+}
+
+void Character::SetInputQueue(InputQueue* queue)
+{
+	inputQueue_ = queue;
+}
+
+void Character::FixedUpdate(float timeStep)
+{
+	GAME_PROFILE(FixedUpdate);
+
+	RigidBody* body = body_.Get(node_);
+	if (!body)
+		return;
+
+	// Controls of this step: the frame's controls plus the key edges and gestures queued for the step. They are not
+	// written back, so nothing consumed here is seen again by the next step of the same frame
+	Controls controls = controls_;
+	unsigned pressed = 0;
+	if (inputQueue_)
+		controls.buttons_ |= inputQueue_->Consume(pressed);
+	if (touch_)
+		pressed |= touch_->ApplyGestures(controls, timeStep);
+	if (latencyTracer_)
+		latencyTracer_->Mark(LATENCY_SAMPLED, pressed);
 
 	// Update the in air timer. Reset if grounded
 	if (!onGround_)
@@ -86,6 +181,8 @@ void Character::FixedUpdate(float timeStep)
 	//if (controls_.IsDown(CTRL_BACK))
 		//moveDir += Vector3::BACK;
 
+	bool wasOnLeftLane = onLeftLane_;
+	bool wasOnRightLane = onRightLane_;
 	if (body->GetPosition().x_ >= 1.5f)
 	{
 		onLeftLane_ = false;
@@ -125,19 +222,17 @@ void Character::FixedUpdate(float timeStep)
 	}
 	}
 	*/
-	/*
-	std::cout << "LeftLane = " << onLeftLane_ << std::endl;
-	std::cout << "MiddleLane = " << onMiddleLane_ << std::endl;
-	std::cout << "RightLane = " << onRightLane_ << std::endl;
-	*/
+	if (onLeftLane_ != wasOnLeftLane || onRightLane_ != wasOnRightLane)
+		GAME_LOG(LOGCAT_PHYSICS, LOG_DEBUG, "Lane %s at z %.1f", onLeftLane_ ? "left" : onRightLane_ ? "right" : "middle",
+			body->GetPosition().z_);
 
-	if (controls_.IsDown(CTRL_RIGHT))
+	if (controls.IsDown(CTRL_RIGHT))
 	{
 		moveDir += Vector3::RIGHT;////////////////////
 		//body->ApplyImpulse(Vector3(3.0f - body->GetPosition().x_, 5.0f, 0.0f));
 	}
 
-	if (controls_.IsDown(CTRL_LEFT))
+	if (controls.IsDown(CTRL_LEFT))
 	{	
 		moveDir += Vector3::LEFT;
 	}
@@ -151,6 +246,9 @@ void Character::FixedUpdate(float timeStep)
 
 	// If in air, allow control, but slower than when on ground
 	body->ApplyImpulse(rot * moveDir * speed_ * (softGrounded ? MOVE_FORCE : INAIR_MOVE_FORCE));
+	if (latencyTracer_)
+		latencyTracer_->Mark(LATENCY_APPLIED, controls.buttons_ & (CTRL_LEFT | CTRL_RIGHT));
+	bool jumped = false;
 	if (softGrounded)
 	{
 		// When on ground, apply a braking force to limit maximum ground velocity
@@ -158,36 +256,36 @@ void Character::FixedUpdate(float timeStep)
 		body->ApplyImpulse(brakeForce);
 
 		// Jump. Must release jump control inbetween jumps
-		if (controls_.IsDown(CTRL_JUMP))
+		if (controls.IsDown(CTRL_JUMP))
 		{
 			if (okToJump_)
 			{
 				body->ApplyImpulse(Vector3::UP * JUMP_FORCE);
 				okToJump_ = false;
-				animCtrl->PlayExclusive("Models/kach/jumping.ani", 0, false, 0.5f);
+				jumped = true;
+				if (latencyTracer_)
+					latencyTracer_->Mark(LATENCY_APPLIED, CTRL_JUMP);
+				animation_.SetState(ANIM_JUMP);
 			}
 		}
 		else
 			okToJump_ = true;
 	}
 
-	// Play walk animation if moving on ground, otherwise fade it out
+	// Play run animation if moving on ground, otherwise fade it out. Off the ground without a jump is falling. A jump
+	// lasts until a real landing: the contacts of the step it starts in and of the take-off do not end it
+	bool landed = onGround_ && (animation_.GetState() != ANIM_JUMP || (!jumped && velocity.y_ < JUMP_LAND_SPEED));
 
-	if (!onGround_)
+	if (!landed)
 	{
-		animCtrl->PlayExclusive("Models/kach/jumping.ani", 0, false, 0.5f);
+		if (animation_.GetState() != ANIM_JUMP)
+			animation_.SetState(ANIM_FALL);
 	}
 	else
 	{
-		if (softGrounded && !moveDir.Equals(Vector3::ZERO)) {
-			animCtrl->PlayExclusive("Models/kach/run2.ani", 0, true, 0.2f);
-		}
-		else
-		{
-			animCtrl->Stop("Models/kach/run2.ani", 0.2f);
-		}
-		// Set walk animation speed proportional to velocity
-		animCtrl->SetSpeed("Models/kach/run2.ani", planeVelocity.Length() * 0.2f);
+		animation_.SetState(softGrounded && !moveDir.Equals(Vector3::ZERO) ? ANIM_RUN : ANIM_NONE);
+		// Set run animation speed proportional to velocity
+		animation_.SetRunSpeed(planeVelocity.Length() * 0.2f);
 	}
 	// Reset grounded flag for next frame
 	onGround_ = false;
@@ -195,6 +293,8 @@ void Character::FixedUpdate(float timeStep)
 
 void Character::HandleNodeCollision(StringHash eventType, VariantMap& eventData)
 {
+	GAME_PROFILE(HandleNodeCollision);
+
 	// Check collision contacts and see if character is standing on ground (look for a contact that has near vertical normal)
 	using namespace NodeCollision;
 
@@ -206,6 +306,7 @@ void Character::HandleNodeCollision(StringHash eventType, VariantMap& eventData)
 	if (otherBody->GetCollisionLayer() == 3 || otherBody->GetCollisionLayer() == 6) {
 		//std::cout << "Kolizja z box" << std::endl;
 		gameOver_ = true;
+		animation_.SetState(ANIM_DEAD);
 	}
 	else if (otherBody->GetCollisionLayer() == 4) {
 		//std::cout << "Kolizja z marchewka" << std::endl;
@@ -3,8 +3,21 @@
 #include <Urho3D/Input/Controls.h>
 #include <Urho3D/Scene/LogicComponent.h>
 
+#include "CharacterAnimation.h"
+#include "ComponentRef.h"
+
+namespace Urho3D
+{
+	class RigidBody;
+}
+
 using namespace Urho3D;
 
+class InputQueue;
+class LatencyTracer;
+class Touch;
+struct CharacterState;
+
 const int CTRL_FORWARD = 1;
 const int CTRL_BACK = 2;
 const int CTRL_LEFT = 4;
@@ -17,6 +30,8 @@ const float BRAKE_FORCE = 0.2f;
 const float JUMP_FORCE =80.0f;// 7.0f;
 const float YAW_SENSITIVITY = 0.1f;
 const float INAIR_THRESHOLD_TIME = 0.2f;
+/// Upward speed below which a ground contact ends a jump. The take-off leaves the character at about 5 m/s.
+const float JUMP_LAND_SPEED = 1.0f;
 
 
 
@@ -36,6 +51,18 @@ public:
 	virtual void Start();
 	/// Handle physics world update. Called by LogicComponent base class.
 	virtual void FixedUpdate(float timeStep);
+	/// Reset the character for a new run: move it to the given position, stop it and clear the run state.
+	void Reset(const Vector3& position);
+	/// Fill in the dynamic state for a run snapshot.
+	void GetState(CharacterState& state) const;
+	/// Restore the dynamic state from a run snapshot.
+	void SetState(const CharacterState& state);
+	/// Set the touch gesture source. Its gestures are added to the controls at the start of every fixed step.
+	void SetTouch(Touch* touch);
+	/// Set the input latency tracer, marked when the traced control is sampled and when it applies its impulse.
+	void SetLatencyTracer(LatencyTracer* tracer);
+	/// Set the queue of control key edges, consumed one fixed step at a time.
+	void SetInputQueue(InputQueue* queue);
 
 	/// Movement controls. Assigned by the main program each frame.
 	Controls controls_;
@@ -48,6 +75,16 @@ public:
 private:
 	/// Handle physics collision event.
 	void HandleNodeCollision(StringHash eventType, VariantMap& eventData);
+	/// Rigid body.
+	ComponentRef<RigidBody> body_;
+	/// Animation state machine.
+	CharacterAnimation animation_;
+	/// Touch gesture source.
+	WeakPtr<Touch> touch_;
+	/// Input latency tracer.
+	WeakPtr<LatencyTracer> latencyTracer_;
+	/// Control key edges.
+	WeakPtr<InputQueue> inputQueue_;
 	/// Grounded flag for movement.
 	bool onGround_;
 	/// Jump flag.
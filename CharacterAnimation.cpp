@@ -0,0 +1,89 @@
+#include <Urho3D/Graphics/Animation.h>
+#include <Urho3D/Graphics/AnimationController.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/ResourceCache.h>
+
+#include "CharacterAnimation.h"
+
+/// Clip and playback of a state.
+struct AnimStateDesc
+{
+	const char* clip_;
+	bool looped_;
+	float fadeTime_;
+};
+
+/// Playback per state. There is no fall clip, falling holds the jump clip; there is no death clip either, a dead
+/// character keeps its last pose.
+static const AnimStateDesc animStates[MAX_ANIM_STATES] =
+{
+	{ 0, false, 0.2f },                             // ANIM_NONE
+	{ "Models/kach/run2.ani", true, 0.2f },         // ANIM_RUN
+	{ "Models/kach/jumping.ani", false, 0.5f },     // ANIM_JUMP
+	{ "Models/kach/jumping.ani", false, 0.5f },     // ANIM_FALL
+	{ 0, false, 0.0f }                              // ANIM_DEAD
+};
+
+/// Smallest run speed change passed on to the controller.
+static const float RUN_SPEED_EPSILON = 0.05f;
+
+CharacterAnimation::CharacterAnimation() :
+	playing_(0),
+	state_(ANIM_NONE),
+	runSpeed_(-1.0f)
+{
+}
+
+void CharacterAnimation::Init(AnimationController* controller, ResourceCache* cache)
+{
+	controller_ = controller;
+	for (unsigned i = 0; i < MAX_ANIM_STATES; ++i)
+	{
+		clips_[i] = animStates[i].clip_ ? cache->GetResource<Animation>(animStates[i].clip_) : 0;
+		if (animStates[i].clip_ && !clips_[i])
+			URHO3D_LOGERRORF("Could not load character animation %s", animStates[i].clip_);
+	}
+}
+
+void CharacterAnimation::SetState(CharacterAnimState state)
+{
+	if (state == state_ || state_ == ANIM_DEAD)
+		return;
+	state_ = state;
+
+	AnimationController* controller = controller_;
+	if (!controller || state == ANIM_DEAD)
+		return;
+
+	// States sharing a clip go over without touching the controller
+	Animation* clip = clips_[state];
+	const AnimStateDesc& desc = animStates[state];
+	if (clip && clip != playing_)
+	{
+		controller->PlayExclusive(clip->GetName(), 0, desc.looped_, desc.fadeTime_);
+		runSpeed_ = -1.0f;
+	}
+	else if (!clip && playing_)
+		controller->Stop(playing_->GetName(), desc.fadeTime_);
+	playing_ = clip;
+}
+
+void CharacterAnimation::SetRunSpeed(float speed)
+{
+	AnimationController* controller = controller_;
+	if (!controller || state_ != ANIM_RUN || !playing_ || Abs(speed - runSpeed_) < RUN_SPEED_EPSILON)
+		return;
+
+	controller->SetSpeed(playing_->GetName(), speed);
+	runSpeed_ = speed;
+}
+
+void CharacterAnimation::Reset()
+{
+	AnimationController* controller = controller_;
+	if (controller)
+		controller->StopAll();
+	playing_ = 0;
+	state_ = ANIM_NONE;
+	runSpeed_ = -1.0f;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Urho3D/Container/Ptr.h>
+
+namespace Urho3D
+{
+	class Animation;
+	class AnimationController;
+	class ResourceCache;
+}
+
+using namespace Urho3D;
+
+/// Animation states of the character.
+enum CharacterAnimState
+{
+	ANIM_NONE = 0,
+	ANIM_RUN,
+	ANIM_JUMP,
+	ANIM_FALL,
+	ANIM_DEAD,
+	MAX_ANIM_STATES
+};
+
+/// Animation state machine of the character.
+/// The clips are resolved once and the animation controller is only called when the state changes, or when the run
+/// speed changes noticeably, instead of hashing and looking up the clip names on every physics step.
+class CharacterAnimation
+{
+public:
+	/// Construct.
+	CharacterAnimation();
+
+	/// Set the controller and resolve the clips.
+	void Init(AnimationController* controller, ResourceCache* cache);
+	/// Change state. A dead character stays dead until reset.
+	void SetState(CharacterAnimState state);
+	/// Set the playback speed of the run clip.
+	void SetRunSpeed(float speed);
+	/// Stop all animations and return to no state.
+	void Reset();
+
+	/// Return current state.
+	CharacterAnimState GetState() const { return state_; }
+
+private:
+	/// Animation controller.
+	WeakPtr<AnimationController> controller_;
+	/// Clip per state, null if the state plays nothing.
+	SharedPtr<Animation> clips_[MAX_ANIM_STATES];
+	/// Clip currently playing.
+	Animation* playing_;
+	/// Current state.
+	CharacterAnimState state_;
+	/// Run clip speed last set to the controller.
+	float runSpeed_;
+};
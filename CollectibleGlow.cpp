@@ -0,0 +1,182 @@
+#include <Urho3D/Graphics/BillboardSet.h>
+#include <Urho3D/Graphics/ParticleEffect.h>
+#include <Urho3D/Scene/Node.h>
+
+#include "CollectibleGlow.h"
+#include "SegmentTemplate.h"
+
+CollectibleGlow::CollectibleGlow(Context* context) :
+	Object(context),
+	numEmitting_(0)
+{
+}
+
+CollectibleGlow::~CollectibleGlow()
+{
+}
+
+void CollectibleGlow::SetEffect(ParticleEffect* effect)
+{
+	effect_ = effect;
+}
+
+Node* CollectibleGlow::AddSegment(Node* segment)
+{
+	if (!segment || !effect_)
+		return 0;
+
+	Group group;
+	const Vector<SharedPtr<Node> >& children = segment->GetChildren();
+	for (unsigned i = 0; i < children.Size(); ++i)
+	{
+		if (!children[i]->GetVar(VAR_CARROT_INDEX).IsEmpty())
+		{
+			Source source;
+			source.carrot_ = children[i];
+			source.numAlive_ = 0;
+			group.sources_.Push(source);
+		}
+	}
+	if (group.sources_.Empty())
+		return 0;
+
+	unsigned numParticles = group.sources_.Size() * GLOW_PARTICLES_PER_CARROT;
+	Node* glowNode = segment->CreateChild("Glow", LOCAL);
+	BillboardSet* billboards = glowNode->CreateComponent<BillboardSet>(LOCAL);
+	billboards->SetMaterial(effect_->GetMaterial());
+	billboards->SetNumBillboards(numParticles);
+	billboards->SetRelative(false);
+	billboards->SetSorted(false);
+	billboards->SetAnimationLodBias(0.0f);
+	for (unsigned i = 0; i < numParticles; ++i)
+		billboards->GetBillboard(i)->enabled_ = false;
+	billboards->Commit();
+
+	// Stagger the ages so every carrot emits at an even rate instead of in bursts
+	group.particles_.Resize(numParticles);
+	for (unsigned i = 0; i < numParticles; ++i)
+	{
+		Particle& particle = group.particles_[i];
+		particle.timeToLive_ = effect_->GetMaxTimeToLive();
+		particle.timer_ = particle.timeToLive_ * (1.0f + (float)(i % GLOW_PARTICLES_PER_CARROT) / GLOW_PARTICLES_PER_CARROT);
+		particle.velocity_ = Vector3::ZERO;
+		particle.size_ = Vector2::ZERO;
+		particle.scale_ = 1.0f;
+	}
+
+	group.billboards_ = billboards;
+	groups_.Push(group);
+	return glowNode;
+}
+
+void CollectibleGlow::Update(float timeStep, const Vector3& cameraPosition)
+{
+	numEmitting_ = 0;
+	if (!effect_)
+		return;
+
+	const Vector3& constantForce = effect_->GetConstantForce();
+	float dampingForce = effect_->GetDampingForce();
+	float sizeAdd = effect_->GetSizeAdd();
+	float sizeMul = effect_->GetSizeMul();
+	const Vector<ColorFrame>& colorFrames = effect_->GetColorFrames();
+	float maxDistanceSquared = GLOW_DISTANCE * GLOW_DISTANCE;
+
+	for (unsigned i = 0; i < groups_.Size();)
+	{
+		Group& group = groups_[i];
+		BillboardSet* billboards = group.billboards_;
+		if (!billboards)
+		{
+			groups_.Erase(i);
+			continue;
+		}
+
+		bool changed = false;
+		for (unsigned j = 0; j < group.sources_.Size(); ++j)
+		{
+			Source& source = group.sources_[j];
+			Node* carrot = source.carrot_;
+			bool emitting = carrot && (carrot->GetWorldPosition() - cameraPosition).LengthSquared() < maxDistanceSquared;
+
+			// Collected or far away and burnt out, nothing to do
+			if (!emitting && !source.numAlive_)
+				continue;
+			if (emitting)
+				++numEmitting_;
+
+			Vector3 emitPosition;
+			if (carrot)
+			{
+				emitPosition = carrot->GetWorldPosition();
+				emitPosition.y_ = 0.0f;
+			}
+
+			source.numAlive_ = 0;
+			unsigned first = j * GLOW_PARTICLES_PER_CARROT;
+			for (unsigned k = first; k < first + GLOW_PARTICLES_PER_CARROT; ++k)
+			{
+				Particle& particle = group.particles_[k];
+				Billboard& billboard = *billboards->GetBillboard(k);
+
+				particle.timer_ += timeStep;
+				if (particle.timer_ >= particle.timeToLive_)
+				{
+					if (!emitting)
+					{
+						billboard.enabled_ = false;
+						continue;
+					}
+					Emit(particle, billboard, emitPosition);
+				}
+
+				// Same motion as the particle emitter: constant force, damping and size change over time
+				particle.velocity_ += (constantForce - dampingForce * particle.velocity_) * timeStep;
+				billboard.position_ += particle.velocity_ * timeStep;
+				if (sizeAdd != 0.0f || sizeMul != 1.0f)
+				{
+					particle.scale_ = Max(particle.scale_ + timeStep * sizeAdd, 0.0f);
+					if (sizeMul != 1.0f)
+						particle.scale_ *= timeStep * (sizeMul - 1.0f) + 1.0f;
+					billboard.size_ = particle.size_ * particle.scale_;
+				}
+
+				if (!colorFrames.Empty())
+				{
+					unsigned index = 0;
+					while (index < colorFrames.Size() - 1 && particle.timer_ >= colorFrames[index + 1].time_)
+						++index;
+					if (index < colorFrames.Size() - 1)
+						billboard.color_ = colorFrames[index].Interpolate(colorFrames[index + 1], particle.timer_);
+					else
+						billboard.color_ = colorFrames[index].color_;
+				}
+
+				++source.numAlive_;
+			}
+			changed = true;
+		}
+
+		if (changed)
+			billboards->Commit();
+		++i;
+	}
+}
+
+void CollectibleGlow::Emit(Particle& particle, Billboard& billboard, const Vector3& position)
+{
+	Vector3 offset = effect_->GetEmitterSize() * Vector3(Random(-0.5f, 0.5f), Random(-0.5f, 0.5f), Random(-0.5f, 0.5f));
+
+	// Keep the leftover time, so the staggering is preserved from one lifetime to the next
+	particle.timer_ = fmodf(particle.timer_, particle.timeToLive_);
+	particle.timeToLive_ = effect_->GetRandomTimeToLive();
+	particle.velocity_ = effect_->GetRandomDirection().Normalized() * effect_->GetRandomVelocity();
+	particle.size_ = effect_->GetRandomSize();
+	particle.scale_ = 1.0f;
+
+	billboard.position_ = position + offset;
+	billboard.size_ = particle.size_;
+	billboard.rotation_ = 0.0f;
+	billboard.uv_ = Rect::POSITIVE;
+	billboard.enabled_ = true;
+}
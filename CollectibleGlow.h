@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+
+namespace Urho3D
+{
+	class BillboardSet;
+	class Node;
+	class ParticleEffect;
+}
+
+using namespace Urho3D;
+
+/// Number of glow particles per carrot.
+const unsigned GLOW_PARTICLES_PER_CARROT = 16;
+/// Camera distance beyond which carrots do not emit.
+const float GLOW_DISTANCE = 60.0f;
+
+/// Glow effect under the carrots.
+/// Each segment gets a single BillboardSet with a fixed number of particles per carrot, simulated here with the
+/// parameters of a particle effect. Only carrots that still exist and are near the camera emit; the particles of a
+/// collected carrot burn out and its slot is skipped from then on, so the cost follows the visible carrots.
+class CollectibleGlow : public Object
+{
+	URHO3D_OBJECT(CollectibleGlow, Object);
+
+public:
+	/// Construct.
+	CollectibleGlow(Context* context);
+	/// Destruct.
+	~CollectibleGlow();
+
+	/// Set the particle effect the glow takes its material, lifetime, motion, size and colors from.
+	void SetEffect(ParticleEffect* effect);
+	/// Create the glow of the carrots of a segment. Return the node holding the billboards, or null if there are none.
+	Node* AddSegment(Node* segment);
+	/// Simulate the particles.
+	void Update(float timeStep, const Vector3& cameraPosition);
+
+	/// Return number of carrots currently emitting.
+	unsigned GetNumEmitting() const { return numEmitting_; }
+
+private:
+	/// Glow particle, the position lives in the billboard.
+	struct Particle
+	{
+		/// Velocity.
+		Vector3 velocity_;
+		/// Size at emission.
+		Vector2 size_;
+		/// Size multiplier.
+		float scale_;
+		/// Age.
+		float timer_;
+		/// Lifetime.
+		float timeToLive_;
+	};
+
+	/// Carrot with its particles.
+	struct Source
+	{
+		/// Carrot node.
+		WeakPtr<Node> carrot_;
+		/// Number of live particles.
+		unsigned numAlive_;
+	};
+
+	/// Glow of one segment.
+	struct Group
+	{
+		/// Billboards, GLOW_PARTICLES_PER_CARROT per source.
+		WeakPtr<BillboardSet> billboards_;
+		/// Sources.
+		Vector<Source> sources_;
+		/// Particles, in the same order as the billboards.
+		PODVector<Particle> particles_;
+	};
+
+	/// Start a particle at a carrot.
+	void Emit(Particle& particle, Billboard& billboard, const Vector3& position);
+
+	/// Effect.
+	SharedPtr<ParticleEffect> effect_;
+	/// Segment groups.
+	Vector<Group> groups_;
+	/// Number of carrots emitting.
+	unsigned numEmitting_;
+};
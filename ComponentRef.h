@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Urho3D/Scene/Node.h>
+
+using namespace Urho3D;
+
+/// Cached reference to a component of a node.
+/// The component is looked up on first use and again only when a different node is passed in. A component that has
+/// been destroyed or removed from the node reads as null until the reference is reset, so per-frame code never
+/// searches the node's component list.
+template <class T> class ComponentRef
+{
+public:
+	/// Construct unresolved.
+	ComponentRef() :
+		resolved_(false)
+	{
+	}
+
+	/// Return the component of the node, resolving it if needed. Return null if the node has no such component.
+	T* Get(Node* node) const
+	{
+		if (!resolved_ || node != node_.Get())
+		{
+			node_ = node;
+			component_ = node ? node->GetComponent<T>() : 0;
+			resolved_ = true;
+		}
+
+		// A component taken off the node may still be alive elsewhere, it does not belong to this node any more
+		T* component = component_;
+		return component && component->GetNode() == node ? component : 0;
+	}
+
+	/// Forget the resolved component, the next Get looks it up again.
+	void Reset()
+	{
+		node_.Reset();
+		component_.Reset();
+		resolved_ = false;
+	}
+
+private:
+	/// Node the component was resolved from.
+	mutable WeakPtr<Node> node_;
+	/// Resolved component.
+	mutable WeakPtr<T> component_;
+	/// Resolved flag.
+	mutable bool resolved_;
+};
@@ -0,0 +1,120 @@
+#include <cstdarg>
+#include <cstdio>
+
+#include <Urho3D/Core/Timer.h>
+
+#include "GameLog.h"
+
+/// Category names written in front of the messages.
+static const char* logCategoryNames[] =
+{
+	"generation",
+	"physics",
+	"audio"
+};
+
+/// Time the drain thread sleeps when the buffer is empty, in milliseconds.
+static const unsigned GAMELOG_DRAIN_INTERVAL = 10;
+
+GameLog* GameLog::instance_ = 0;
+
+GameLog::GameLog(Context* context) :
+	Object(context),
+	writePos_(0),
+	readPos_(0),
+	numDropped_(0)
+{
+	for (unsigned i = 0; i < GAMELOG_CAPACITY; ++i)
+		slots_[i].sequence_.store(i, std::memory_order_relaxed);
+
+	// Debug messages only in debug builds, the checks of the disabled ones cost a compare
+	for (unsigned i = 0; i < MAX_LOG_CATEGORIES; ++i)
+	{
+#ifdef _DEBUG
+		levels_[i] = LOG_DEBUG;
+#else
+		levels_[i] = LOG_INFO;
+#endif
+	}
+
+	instance_ = this;
+	Run();
+}
+
+GameLog::~GameLog()
+{
+	instance_ = 0;
+	shouldRun_ = false;
+	Stop();
+	Drain();
+}
+
+void GameLog::SetLevel(LogCategory category, int level)
+{
+	levels_[category] = level;
+}
+
+bool GameLog::Write(LogCategory category, int level, const char* format, ...)
+{
+	// Claim a slot: it is free when its sequence equals the write position. Bounded multi-producer queue, producers
+	// only contend on the write position
+	unsigned pos = writePos_.load(std::memory_order_relaxed);
+	Slot* slot;
+	for (;;)
+	{
+		slot = &slots_[pos & (GAMELOG_CAPACITY - 1)];
+		int diff = (int)(slot->sequence_.load(std::memory_order_acquire) - pos);
+		if (diff == 0)
+		{
+			if (writePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+		{
+			numDropped_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else
+			pos = writePos_.load(std::memory_order_relaxed);
+	}
+
+	slot->level_ = level;
+	slot->category_ = category;
+	va_list args;
+	va_start(args, format);
+	vsnprintf(slot->text_, GAMELOG_MESSAGE_LENGTH, format, args);
+	va_end(args);
+
+	// Publish the message to the drain thread
+	slot->sequence_.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+void GameLog::ThreadFunction()
+{
+	while (shouldRun_)
+	{
+		if (!Drain())
+			Time::Sleep(GAMELOG_DRAIN_INTERVAL);
+	}
+}
+
+unsigned GameLog::Drain()
+{
+	unsigned numDrained = 0;
+	for (;;)
+	{
+		Slot& slot = slots_[readPos_ & (GAMELOG_CAPACITY - 1)];
+		if ((int)(slot.sequence_.load(std::memory_order_acquire) - (readPos_ + 1)) < 0)
+			break;
+
+		// The engine log queues messages from other threads and writes them to the log file on the main thread
+		Log::Write(slot.level_, String("[") + logCategoryNames[slot.category_] + "] " + slot.text_);
+
+		// Hand the slot back to the writers for the next lap of the ring
+		slot.sequence_.store(readPos_ + GAMELOG_CAPACITY, std::memory_order_release);
+		++readPos_;
+		++numDrained;
+	}
+	return numDrained;
+}
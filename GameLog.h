@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Thread.h>
+#include <Urho3D/IO/Log.h>
+
+using namespace Urho3D;
+
+/// Game log categories.
+enum LogCategory
+{
+	LOGCAT_GENERATION = 0,
+	LOGCAT_PHYSICS,
+	LOGCAT_AUDIO,
+	MAX_LOG_CATEGORIES
+};
+
+/// Number of messages the ring buffer holds, a power of two.
+const unsigned GAMELOG_CAPACITY = 512;
+/// Longest message in characters, longer ones are cut.
+const unsigned GAMELOG_MESSAGE_LENGTH = 120;
+
+/// Log a formatted message in a category. The arguments are not evaluated when the category or level is disabled.
+#define GAME_LOG(category, level, ...) \
+	do \
+	{ \
+		GameLog* gameLog = GameLog::GetInstance(); \
+		if (gameLog && gameLog->IsEnabled(category, level)) \
+			gameLog->Write(category, level, __VA_ARGS__); \
+	} while (false)
+
+/// Game log with categories.
+/// Messages are formatted straight into a fixed-size slot of a lock-free ring buffer, so logging from the generation,
+/// physics or audio code never takes a lock, allocates or touches the disk. A background thread drains the buffer into
+/// the engine log. When the buffer is full, messages are dropped and counted instead of blocking.
+class GameLog : public Object, public Thread
+{
+	URHO3D_OBJECT(GameLog, Object);
+
+public:
+	/// Construct and start the drain thread.
+	GameLog(Context* context);
+	/// Drain the remaining messages and stop the thread.
+	~GameLog();
+
+	/// Set the lowest level logged in a category, LOG_NONE disables it.
+	void SetLevel(LogCategory category, int level);
+	/// Format and queue a message. Return false if it was dropped.
+	bool Write(LogCategory category, int level, const char* format, ...);
+
+	/// Return whether messages of a level are logged in a category.
+	bool IsEnabled(LogCategory category, int level) const { return level >= levels_[category]; }
+	/// Return number of messages dropped because the buffer was full.
+	unsigned GetNumDropped() const { return numDropped_; }
+	/// Return the game log instance, or null if none exists.
+	static GameLog* GetInstance() { return instance_; }
+
+	/// Drain thread loop.
+	virtual void ThreadFunction();
+
+private:
+	/// Ring buffer slot.
+	struct Slot
+	{
+		/// Sequence number telling whether the slot is free or holds a message.
+		std::atomic<unsigned> sequence_;
+		/// Message level.
+		int level_;
+		/// Message category.
+		LogCategory category_;
+		/// Message text.
+		char text_[GAMELOG_MESSAGE_LENGTH];
+	};
+
+	/// Pass the queued messages to the engine log. Return number of messages passed.
+	unsigned Drain();
+
+	/// Ring buffer.
+	Slot slots_[GAMELOG_CAPACITY];
+	/// Position of the next message to write.
+	std::atomic<unsigned> writePos_;
+	/// Position of the next message to drain, used by the drain thread only.
+	unsigned readPos_;
+	/// Messages dropped.
+	std::atomic<unsigned> numDropped_;
+	/// Lowest level logged per category.
+	int levels_[MAX_LOG_CATEGORIES];
+
+	/// The game log instance.
+	static GameLog* instance_;
+};
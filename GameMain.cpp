@@ -0,0 +1,5 @@
+#include <Urho3D/Engine/Application.h>
+
+#include "MainScene.h"
+
+URHO3D_DEFINE_APPLICATION_MAIN(MainScene)
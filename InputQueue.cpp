@@ -0,0 +1,117 @@
+#include <Urho3D/Input/InputEvents.h>
+#include <Urho3D/UI/UI.h>
+
+#include "Character.h"
+#include "InputQueue.h"
+#include "LatencyTracer.h"
+#include "Touch.h"
+
+/// Control key and the control it drives.
+struct KeyBinding
+{
+	int key_;
+	unsigned control_;
+};
+
+/// Keyboard bindings of the controls.
+static const KeyBinding keyBindings[] =
+{
+	{ KEY_W, CTRL_FORWARD },
+	{ KEY_DOWN, CTRL_BACK },
+	{ KEY_LEFT, CTRL_LEFT },
+	{ KEY_RIGHT, CTRL_RIGHT },
+	{ KEY_UP, CTRL_JUMP }
+};
+
+InputQueue::InputQueue(Context* context) :
+	Object(context),
+	held_(0),
+	step_(0)
+{
+	SubscribeToEvent(E_KEYDOWN, URHO3D_HANDLER(InputQueue, HandleKeyDown));
+	SubscribeToEvent(E_KEYUP, URHO3D_HANDLER(InputQueue, HandleKeyUp));
+}
+
+InputQueue::~InputQueue()
+{
+}
+
+unsigned InputQueue::Consume(unsigned& pressed)
+{
+	pressed = 0;
+
+	// Edges are in arrival order, so the ones of this step are at the front
+	unsigned numConsumed = 0;
+	while (numConsumed < edges_.Size() && edges_[numConsumed].step_ <= step_)
+	{
+		const Edge& edge = edges_[numConsumed++];
+		if (edge.down_)
+		{
+			held_ |= edge.control_;
+			pressed |= edge.control_;
+		}
+		else
+			held_ &= ~edge.control_;
+	}
+	edges_.Erase(0, numConsumed);
+
+	++step_;
+	return held_ | pressed;
+}
+
+void InputQueue::Clear()
+{
+	edges_.Clear();
+	held_ = 0;
+}
+
+void InputQueue::SetLatencyTracer(LatencyTracer* tracer)
+{
+	latencyTracer_ = tracer;
+}
+
+void InputQueue::SetTouch(Touch* touch)
+{
+	touch_ = touch;
+}
+
+void InputQueue::HandleKeyDown(StringHash eventType, VariantMap& eventData)
+{
+	using namespace KeyDown;
+
+	// Keys typed into the UI do not steer
+	if (!eventData[P_REPEAT].GetBool() && !GetSubsystem<UI>()->GetFocusElement())
+		Push(eventData[P_KEY].GetInt(), true);
+}
+
+void InputQueue::HandleKeyUp(StringHash eventType, VariantMap& eventData)
+{
+	using namespace KeyUp;
+
+	// Releases always go through, so a control is never left held
+	Push(eventData[P_KEY].GetInt(), false);
+}
+
+void InputQueue::Push(int key, bool down)
+{
+	for (unsigned i = 0; i < sizeof keyBindings / sizeof keyBindings[0]; ++i)
+	{
+		if (keyBindings[i].key_ != key)
+			continue;
+
+		// The gyroscope steers on its own, the arrow keys would fight it. Releases still go through
+		if (down && touch_ && touch_->useGyroscope_ && (keyBindings[i].control_ & (CTRL_LEFT | CTRL_RIGHT)))
+			return;
+
+		// Events arrive between frames, the first step that can see the edge is the next one to run
+		Edge edge;
+		edge.step_ = step_;
+		edge.control_ = keyBindings[i].control_;
+		edge.down_ = down;
+		edges_.Push(edge);
+		// Only the controls that apply an impulse of their own are traced
+		if (down && latencyTracer_ && (edge.control_ & (CTRL_LEFT | CTRL_RIGHT | CTRL_JUMP)))
+			latencyTracer_->Begin(edge.control_);
+		return;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+
+using namespace Urho3D;
+
+class LatencyTracer;
+class Touch;
+
+/// Queue of control key edges for the fixed step.
+/// Key presses and releases are queued as they arrive, stamped with the fixed step they belong to, and each is consumed
+/// by exactly one step. A key tapped within one frame still counts as pressed for one step, and a press is never
+/// seen twice when a frame runs two steps, whatever the ratio between the frame and physics rates.
+class InputQueue : public Object
+{
+	URHO3D_OBJECT(InputQueue, Object);
+
+public:
+	/// Construct.
+	InputQueue(Context* context);
+	/// Destruct.
+	~InputQueue();
+
+	/// Consume the edges of the next fixed step. Return the controls down during the step; the controls pressed in it
+	/// are returned in pressed.
+	unsigned Consume(unsigned& pressed);
+	/// Drop the queued edges and release all controls.
+	void Clear();
+	/// Set the input latency tracer, started by the control key presses.
+	void SetLatencyTracer(LatencyTracer* tracer);
+	/// Set the touch controls. While their gyroscope steers, the lateral keys are ignored.
+	void SetTouch(Touch* touch);
+
+	/// Return number of the next fixed step.
+	unsigned GetStep() const { return step_; }
+	/// Return number of edges waiting.
+	unsigned GetNumQueued() const { return edges_.Size(); }
+
+private:
+	/// Control key edge.
+	struct Edge
+	{
+		/// Fixed step the edge belongs to.
+		unsigned step_;
+		/// Control bit.
+		unsigned control_;
+		/// Pressed or released.
+		bool down_;
+	};
+
+	/// Handle key press.
+	void HandleKeyDown(StringHash eventType, VariantMap& eventData);
+	/// Handle key release.
+	void HandleKeyUp(StringHash eventType, VariantMap& eventData);
+	/// Queue an edge.
+	void Push(int key, bool down);
+
+	/// Input latency tracer.
+	WeakPtr<LatencyTracer> latencyTracer_;
+	/// Touch controls.
+	WeakPtr<Touch> touch_;
+	/// Queued edges in arrival order.
+	PODVector<Edge> edges_;
+	/// Controls held after the consumed edges.
+	unsigned held_;
+	/// Number of the next fixed step.
+	unsigned step_;
+};
@@ -0,0 +1,131 @@
+#include <Urho3D/Graphics/GraphicsEvents.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Math/MathDefs.h>
+
+#include "LatencyTracer.h"
+
+/// Time after which a trace that has not reached the physics step is dropped, in microseconds.
+static const long long LATENCY_TIMEOUT = 500000;
+
+/// Stage names for the log.
+static const char* latencyStageNames[] =
+{
+	"Event",
+	"Sampled",
+	"Applied",
+	"Presented"
+};
+
+LatencyTracer::LatencyTracer(Context* context) :
+	Object(context),
+	control_(0),
+	tracing_(false)
+{
+	Clear();
+
+	SubscribeToEvent(E_ENDRENDERING, URHO3D_HANDLER(LatencyTracer, HandleEndRendering));
+}
+
+LatencyTracer::~LatencyTracer()
+{
+}
+
+void LatencyTracer::Begin(unsigned control)
+{
+	if (tracing_)
+		return;
+
+	stamps_[LATENCY_EVENT] = timer_.GetUSec(false);
+	for (unsigned i = LATENCY_SAMPLED; i < MAX_LATENCY_STAGES; ++i)
+		stamps_[i] = -1;
+	control_ = control;
+	tracing_ = true;
+}
+
+void LatencyTracer::Mark(LatencyStage stage, unsigned controls)
+{
+	if (tracing_ && (controls & control_) && stamps_[stage] < 0)
+		stamps_[stage] = timer_.GetUSec(false);
+}
+
+void LatencyTracer::Clear()
+{
+	for (unsigned i = 0; i < MAX_LATENCY_STAGES; ++i)
+	{
+		for (unsigned j = 0; j < NUM_LATENCY_BINS; ++j)
+			bins_[i][j] = 0;
+		numSamples_[i] = 0;
+	}
+	numTraces_ = 0;
+}
+
+void LatencyTracer::LogHistograms() const
+{
+	URHO3D_LOGINFOF("Input latency over %u traces", numTraces_);
+	for (unsigned i = LATENCY_SAMPLED; i < MAX_LATENCY_STAGES; ++i)
+	{
+		if (!numSamples_[i])
+			continue;
+
+		URHO3D_LOGINFOF("%s: %u samples, median %d ms, 95%% %d ms", latencyStageNames[i], numSamples_[i],
+			(int)Round(GetPercentile((LatencyStage)i, 0.5f)), (int)Round(GetPercentile((LatencyStage)i, 0.95f)));
+		for (unsigned j = 0; j < NUM_LATENCY_BINS; ++j)
+		{
+			if (!bins_[i][j])
+				continue;
+			String bar;
+			bar.Resize((bins_[i][j] * 50 + numSamples_[i] - 1) / numSamples_[i]);
+			for (unsigned k = 0; k < bar.Length(); ++k)
+				bar[k] = '#';
+			if (j < NUM_LATENCY_BINS - 1)
+				URHO3D_LOGINFOF("  %d-%d ms: %u %s", (int)(j * LATENCY_BIN_WIDTH), (int)((j + 1) * LATENCY_BIN_WIDTH),
+					bins_[i][j], bar.CString());
+			else
+				URHO3D_LOGINFOF("  %d+ ms: %u %s", (int)(j * LATENCY_BIN_WIDTH), bins_[i][j], bar.CString());
+		}
+	}
+}
+
+float LatencyTracer::GetPercentile(LatencyStage stage, float percentile) const
+{
+	if (!numSamples_[stage])
+		return 0.0f;
+
+	// Resolution is a bin, report the upper edge of the bin the percentile falls in
+	unsigned target = (unsigned)Ceil(percentile * numSamples_[stage]);
+	unsigned count = 0;
+	for (unsigned i = 0; i < NUM_LATENCY_BINS; ++i)
+	{
+		count += bins_[stage][i];
+		if (count >= target)
+			return (i + 1) * LATENCY_BIN_WIDTH;
+	}
+	return NUM_LATENCY_BINS * LATENCY_BIN_WIDTH;
+}
+
+void LatencyTracer::HandleEndRendering(StringHash eventType, VariantMap& eventData)
+{
+	if (!tracing_)
+		return;
+
+	long long now = timer_.GetUSec(false);
+	if (stamps_[LATENCY_APPLIED] < 0)
+	{
+		if (now - stamps_[LATENCY_EVENT] > LATENCY_TIMEOUT)
+			tracing_ = false;
+		return;
+	}
+
+	// The frame rendered after the impulse is the first one that can show the motion
+	stamps_[LATENCY_PRESENTED] = now;
+	for (unsigned i = LATENCY_SAMPLED; i < MAX_LATENCY_STAGES; ++i)
+	{
+		if (stamps_[i] < 0)
+			continue;
+		unsigned bin = (unsigned)((stamps_[i] - stamps_[LATENCY_EVENT]) / 1000.0f / LATENCY_BIN_WIDTH);
+		++bins_[i][Min(bin, NUM_LATENCY_BINS - 1)];
+		++numSamples_[i];
+	}
+	++numTraces_;
+	tracing_ = false;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Timer.h>
+
+using namespace Urho3D;
+
+/// Stages an input passes on its way to the screen.
+enum LatencyStage
+{
+	/// Control key pressed or gesture recognized.
+	LATENCY_EVENT = 0,
+	/// Control edge handed to a fixed step.
+	LATENCY_SAMPLED,
+	/// First physics step that applied the impulse of the traced control.
+	LATENCY_APPLIED,
+	/// First frame rendered after the impulse.
+	LATENCY_PRESENTED,
+	MAX_LATENCY_STAGES
+};
+
+/// Width of a latency histogram bin in milliseconds.
+const float LATENCY_BIN_WIDTH = 4.0f;
+/// Number of latency histogram bins, the last one collects everything longer.
+const unsigned NUM_LATENCY_BINS = 26;
+
+/// Traces input events through the update stages.
+/// The input queue and the touch gestures start a trace when a steering control is pressed, stamped with a high
+/// resolution timer. The physics step and the end of rendering mark the stages they reach for that control; the time of
+/// each stage from the event goes into a histogram per stage. One trace is in flight at a time, controls pressed
+/// meanwhile are not traced. A trace that does not reach the physics step in time, for example a jump pressed in the
+/// air, is dropped.
+class LatencyTracer : public Object
+{
+	URHO3D_OBJECT(LatencyTracer, Object);
+
+public:
+	/// Construct.
+	LatencyTracer(Context* context);
+	/// Destruct.
+	~LatencyTracer();
+
+	/// Start a trace of a control if none is in flight.
+	void Begin(unsigned control);
+	/// Mark a stage of the trace in flight if its control is among the controls given. Only the first mark of a stage
+	/// counts.
+	void Mark(LatencyStage stage, unsigned controls);
+	/// Clear the histograms.
+	void Clear();
+	/// Write the histograms to the log.
+	void LogHistograms() const;
+
+	/// Return number of traces completed.
+	unsigned GetNumTraces() const { return numTraces_; }
+	/// Return the latency of a stage at a percentile from 0 to 1, in milliseconds.
+	float GetPercentile(LatencyStage stage, float percentile) const;
+
+private:
+	/// Handle end of rendering.
+	void HandleEndRendering(StringHash eventType, VariantMap& eventData);
+
+	/// Timer the stages are stamped with.
+	HiresTimer timer_;
+	/// Stage times of the trace in flight in microseconds, negative if not reached.
+	long long stamps_[MAX_LATENCY_STAGES];
+	/// Control of the trace in flight.
+	unsigned control_;
+	/// Trace in flight.
+	bool tracing_;
+	/// Histogram per stage.
+	unsigned bins_[MAX_LATENCY_STAGES][NUM_LATENCY_BINS];
+	/// Samples per stage.
+	unsigned numSamples_[MAX_LATENCY_STAGES];
+	/// Completed traces.
+	unsigned numTraces_;
+};
@@ -1,12 +1,13 @@
-#include <iostream>
 #include <string>
 
 #include <Urho3D/Audio/Audio.h>
 #include <Urho3D/Audio/AudioEvents.h>
 #include <Urho3D/Audio/Sound.h>
 #include <Urho3D/Audio/SoundSource.h>
+#include <Urho3D/Audio/SoundStream.h>
 #include <Urho3D/Core/CoreEvents.h>
 #include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/Timer.h>
 #include <Urho3D/Engine/Engine.h>
 #include <Urho3D/Graphics/AnimatedModel.h>
 #include <Urho3D/Graphics/AnimationController.h>
@@ -18,6 +19,7 @@
 #include <Urho3D/Graphics/ParticleEmitter.h>
 #include <Urho3D/Graphics/ParticleEffect.h>
 #include <Urho3D/Graphics/Renderer.h>
+#include <Urho3D/Graphics/RenderPath.h>
 #include <Urho3D/Graphics/Zone.h>
 #include <Urho3D/Input/Controls.h>
 #include <Urho3D/Input/Input.h>
@@ -28,6 +30,7 @@
 #include <Urho3D/Physics/PhysicsEvents.h>
 #include <Urho3D/Physics/RigidBody.h>
 #include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Resource/XMLFile.h>
 #include <Urho3D/Scene/Scene.h>
 #include <Urho3D/Scene/SceneEvents.h>
 #include <Urho3D/Scene/Component.h>
@@ -41,29 +44,46 @@
 
 #include <Urho3D/DebugNew.h>
 
+#include "CameraCollision.h"
 #include "Character.h"
+#include "CollectibleGlow.h"
+#include "GameLog.h"
+#include "InputQueue.h"
+#include "LatencyTracer.h"
 #include "MainScene.h"
+#include "OcclusionStats.h"
+#include "QualityGovernor.h"
+#include "RunSnapshot.h"
+#include "SegmentTemplate.h"
+#include "ShadowBudget.h"
+#include "SnapshotWriter.h"
+#include "SoundPool.h"
+#include "Spawner.h"
+#include "StaticBatcher.h"
 #include "Touch.h"
+#include "TraceProfiler.h"
+#include "TreeImpostors.h"
 
-URHO3D_DEFINE_APPLICATION_MAIN(MainScene)
-
-const unsigned NUM_FLOOR = 10;
-int NUM_BOXES = 10;
-int NUM_CARROTS = 10;
-
-int prevObstaclesNr = 0;
+/// Background music, streamed from the compressed file.
+static const char* MUSIC_FILE = "bin/Data/Music/Ninja Gods.ogg";
 
 MainScene::MainScene(Context* context) :
 	App(context), 
 	time_(0), 
+	collected_(0),
 	level_(0), 
 	currentLevel_(0),
-	musicSource_(0),
 	gamePaused_(true), 
-	gameOver_(false)
+	gameOver_(false),
+	numBoxes_(0),
+	prevObstaclesNr_(0),
+	runSeed_(1),
+	autosaveTimer_(0.0f)
 {
 	// Register factory and attributes for the Character component so it can be created via CreateComponent, and loaded / saved
 	Character::RegisterObject(context);
+
+	soundPool_ = new SoundPool(context);
 }
 
 MainScene::~MainScene()
@@ -74,47 +94,261 @@ void MainScene::Start()
 {
 	App::Start();
 
+	// Logging from the game code goes through a ring buffer drained by its own thread
+	gameLog_ = new GameLog(context_);
+
+	// Profiled scopes of the game loop, F9 starts and stops recording a trace
+	traceProfiler_ = new TraceProfiler(context_);
+
 	if (touchEnabled_)
 		touch_ = new Touch(context_, TOUCH_SENSITIVITY);
 
 	CreateUI();
-	
 
+	CreateSystems();
+
+	// The floor is the occluder, see what it hides
+	occlusionStats_ = new OcclusionStats(context_);
+	GetSubsystem<Renderer>()->SetMaxOccluderTriangles(MAX_OCCLUDER_TRIANGLES);
+
+	// Saves are written by a background thread, so neither starting a run nor autosaving waits on the disk
+	snapshotWriter_ = new SnapshotWriter(context_, GetSubsystem<FileSystem>()->GetAppPreferencesDir("urho3d", "saves") +
+		GetTypeName() + ".sav");
 }
 
+void MainScene::CreateSystems()
+{
+	// Prototypes of everything a segment spawns, built once with all resources resolved
+	spawner_ = new Spawner(context_);
+	spawner_->CreatePrototypes();
 
-void MainScene::PlayGame(StringHash eventType, VariantMap& eventData) {
-	if (gameOver_ == true) {
-		scene_->SetUpdateEnabled(false);
-		scene_->Clear(true, true);
-		scene_->Remove();
-		
-		time_ = 0.0;
-		
-		gameOver_ = false;
-	}
-	level_ = 0;
-	currentLevel_ = 0;
-	CreateScene();
+	// Draw and shadow distances per category, set on the prototypes so every spawned copy has them
+	shadowBudget_ = new ShadowBudget(context_);
+	shadowBudget_->Apply(spawner_);
 
-	scene_->SetUpdateEnabled(true);
+	// Segment layouts, compiled once into placement tables
+	ResourceCache* cache = GetSubsystem<ResourceCache>();
+	startTemplate_ = new SegmentTemplate(context_, spawner_);
+	startTemplate_->Load(cache->GetResource<XMLFile>("bin/Data/Segments/Start.xml"));
+	segmentTemplate_ = new SegmentTemplate(context_, spawner_);
+	segmentTemplate_->Load(cache->GetResource<XMLFile>("bin/Data/Segments/Default.xml"));
 
-	gamePaused_ = false;
+	// Quality settings follow the measured frame time
+	qualityGovernor_ = new QualityGovernor(context_);
 
+	// Glow of the carrots, one particle set per segment
+	collectibleGlow_ = new CollectibleGlow(context_);
+	collectibleGlow_->SetEffect(cache->GetResource<ParticleEffect>("bin/Data/Particle/torch_fire.xml"));
 
+	// Distant trees are drawn from an atlas rendered once from the tree prototypes
+	treeImpostors_ = new TreeImpostors(context_);
+	treeImpostors_->Create(spawner_);
+
+	// Input latency through the update stages, F8 writes the histograms to the log
+	latencyTracer_ = new LatencyTracer(context_);
+	if (touch_)
+		touch_->SetLatencyTracer(latencyTracer_);
+
+	// Control key edges for the fixed step, a bound key press starts a latency trace
+	inputQueue_ = new InputQueue(context_);
+	inputQueue_->SetLatencyTracer(latencyTracer_);
+	inputQueue_->SetTouch(touch_);
+
+	// The camera collides with the floor and walls of the segment it is in
+	cameraCollision_ = new CameraCollision(context_);
+
+	// Floor, grass and walls of a segment are merged into one model per material
+	staticBatcher_ = new StaticBatcher(context_);
+}
+
+
+void MainScene::PlayGame(StringHash eventType, VariantMap& eventData) {
 	UI* ui = GetSubsystem<UI>();
 	ui->GetRoot()->RemoveAllChildren();
 	//ui->SetCursor(0);
 
-	CreateCharacter();
+	// The static world and the character are built only for the first run, a restart just resets the run
+	if (!scene_)
+	{
+		CreateScene();
+		CreateCharacter();
+		SubscribeToEvents();
+	}
+
+	ResetRun(Time::GetSystemTime());
+
+	ResumePlay();
+}
+
+void MainScene::ContinueGame(StringHash eventType, VariantMap& eventData) {
+	// Continue from the last checkpoint, or start over if there is none
+	if (!checkpoint_.IsValid())
+	{
+		PlayGame(eventType, eventData);
+		return;
+	}
+
+	GetSubsystem<UI>()->GetRoot()->RemoveAllChildren();
+	RestoreSnapshot(checkpoint_);
+
+	ResumePlay();
+}
 
-	SubscribeToEvents();
+void MainScene::ResumePlay() {
+	gameOver_ = false;
+	gamePaused_ = false;
+	scene_->SetUpdateEnabled(true);
+
+	PlayMusic(GetSubsystem<ResourceCache>());
 
 	App::InitMouseMode(MM_RELATIVE);
 
 	CreateText();
+}
 
+void MainScene::ResetRun(unsigned seed) {
+	HiresTimer resetTimer;
+	ResourceCache* cache = GetSubsystem<ResourceCache>();
 
+	// Drop every segment of the previous run, the zone, light, sky, camera and physics world stay as they are
+	segmentsNode_->RemoveAllChildren();
+	segments_.Clear();
+
+	runSeed_ = seed;
+	time_ = 0.0f;
+	collected_ = 0;
+	level_ = 0;
+	currentLevel_ = 0;
+	numBoxes_ = segmentTemplate_->GetObstacleRows();
+	prevObstaclesNr_ = 0;
+	autosaveTimer_ = 0.0f;
+
+	CreateSegment(cache, level_);
+	cameraCollision_->SetSegments(segmentsNode_, 100.0f);
+
+	if (character_)
+		character_->Reset(Vector3(0.0f, 1.1f, 1.0f));
+
+	// The start of the run is the first checkpoint
+	TakeSnapshot(checkpoint_);
+
+	URHO3D_LOGINFOF("Run reset with seed %u in %f ms", seed, resetTimer.GetUSec(false) / 1000.0f);
+}
+
+void MainScene::TakeSnapshot(RunSnapshot& snapshot) {
+	if (!character_)
+	{
+		snapshot.Clear();
+		return;
+	}
+
+	snapshot.valid_ = true;
+	snapshot.runSeed_ = runSeed_;
+	snapshot.randomSeed_ = GetRandomSeed();
+	snapshot.time_ = time_;
+	snapshot.level_ = level_;
+	snapshot.currentLevel_ = currentLevel_;
+	snapshot.numBoxes_ = numBoxes_;
+	snapshot.prevObstaclesNr_ = prevObstaclesNr_;
+	character_->GetState(snapshot.character_);
+
+	snapshot.segments_ = segments_;
+	for (unsigned i = 0; i < snapshot.segments_.Size(); ++i)
+		snapshot.segments_[i].carrots_ = GetCarrotMask(snapshot.segments_[i].level_);
+}
+
+bool MainScene::RestoreSnapshot(const RunSnapshot& snapshot) {
+	if (!snapshot.IsValid() || !character_)
+		return false;
+
+	HiresTimer restoreTimer;
+	ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+	// Segments of another run can not be reused
+	if (snapshot.runSeed_ != runSeed_)
+	{
+		segmentsNode_->RemoveAllChildren();
+		segments_.Clear();
+		runSeed_ = snapshot.runSeed_;
+	}
+
+	// Keep the segments that are still alive, only drop the ones the snapshot does not have or that lost carrots since
+	for (int i = (int)segments_.Size() - 1; i >= 0; --i)
+	{
+		int level = segments_[i].level_;
+		const SegmentDescriptor* saved = 0;
+		for (unsigned j = 0; j < snapshot.segments_.Size(); ++j)
+		{
+			if (snapshot.segments_[j].level_ == level)
+				saved = &snapshot.segments_[j];
+		}
+
+		unsigned carrots = GetCarrotMask(level);
+		if (!saved || (saved->carrots_ & ~carrots))
+			DeleteFloor(level);
+		else if (carrots & ~saved->carrots_)
+			RemoveCarrots(level, carrots & ~saved->carrots_);
+	}
+
+	// Rebuild the missing segments from the generator state they were originally built with
+	for (unsigned i = 0; i < snapshot.segments_.Size(); ++i)
+	{
+		const SegmentDescriptor& saved = snapshot.segments_[i];
+		if (segmentsNode_->GetChild("Segment" + String(saved.level_)))
+			continue;
+
+		numBoxes_ = saved.numBoxes_;
+		prevObstaclesNr_ = saved.prevObstaclesNr_;
+		CreateSegment(cache, saved.level_);
+		RemoveCarrots(saved.level_, GetCarrotMask(saved.level_) & ~saved.carrots_);
+	}
+
+	time_ = snapshot.time_;
+	level_ = snapshot.level_;
+	currentLevel_ = snapshot.currentLevel_;
+	numBoxes_ = snapshot.numBoxes_;
+	prevObstaclesNr_ = snapshot.prevObstaclesNr_;
+	SetRandomSeed(snapshot.randomSeed_);
+
+	character_->SetState(snapshot.character_);
+	collected_ = snapshot.character_.collected_;
+	cameraCollision_->SetSegments(segmentsNode_, 100.0f);
+
+	URHO3D_LOGINFOF("Snapshot restored in %f ms", restoreTimer.GetUSec(false) / 1000.0f);
+	return true;
+}
+
+unsigned MainScene::GetCarrotMask(int level) {
+	Node* segment = segmentsNode_->GetChild("Segment" + String(level));
+	if (!segment)
+		return 0;
+
+	unsigned mask = 0;
+	const Vector<SharedPtr<Node> >& children = segment->GetChildren();
+	for (unsigned i = 0; i < children.Size(); ++i)
+	{
+		const Variant& index = children[i]->GetVar(VAR_CARROT_INDEX);
+		if (!index.IsEmpty())
+			mask |= 1U << index.GetInt();
+	}
+	return mask;
+}
+
+void MainScene::RemoveCarrots(int level, unsigned mask) {
+	Node* segment = segmentsNode_->GetChild("Segment" + String(level));
+	if (!segment || !mask)
+		return;
+
+	PODVector<Node*> carrots;
+	const Vector<SharedPtr<Node> >& children = segment->GetChildren();
+	for (unsigned i = 0; i < children.Size(); ++i)
+	{
+		const Variant& index = children[i]->GetVar(VAR_CARROT_INDEX);
+		if (!index.IsEmpty() && (mask & (1U << index.GetInt())))
+			carrots.Push(children[i]);
+	}
+	for (unsigned i = 0; i < carrots.Size(); ++i)
+		carrots[i]->Remove();
 }
 
 void MainScene::QuitGame(StringHash eventType, VariantMap& eventData) {
@@ -184,6 +418,14 @@ void MainScene::CreateText()
 	text2_->SetHorizontalAlignment(HA_RIGHT);
 	text2_->SetVerticalAlignment(VA_BOTTOM);
 	GetSubsystem<UI>()->GetRoot()->AddChild(text2_);
+
+	// Render statistics
+	textStats_ = new Text(context_);
+	textStats_->SetFont(cache->GetResource<Font>("Fonts/BlueHighway.ttf"), 12);
+	textStats_->SetColor(Color(1, 1, 1));
+	textStats_->SetHorizontalAlignment(HA_LEFT);
+	textStats_->SetVerticalAlignment(VA_BOTTOM);
+	GetSubsystem<UI>()->GetRoot()->AddChild(textStats_);
 }
 void MainScene::CreateScene()
 {
@@ -201,11 +443,24 @@ void MainScene::CreateScene()
 	cameraNode_ = new Node(context_);
 	Camera* camera = cameraNode_->CreateComponent<Camera>();
 	camera->SetFarClip(300.0f);
-	GetSubsystem<Renderer>()->SetViewport(0, new Viewport(context_, scene_, camera));
+	// There is no renderer when running headless, as the benchmark does
+	Renderer* renderer = GetSubsystem<Renderer>();
+	if (renderer)
+	{
+		Viewport* viewport = new Viewport(context_, scene_, camera);
+		renderer->SetViewport(0, viewport);
+
+		// Post-process on a copy of the default render path, the quality governor switches the passes on and off by tag
+		SharedPtr<RenderPath> renderPath = viewport->GetRenderPath()->Clone();
+		renderPath->Append(cache->GetResource<XMLFile>("PostProcess/Bloom.xml"));
+		renderPath->Append(cache->GetResource<XMLFile>("PostProcess/FXAA2.xml"));
+		viewport->SetRenderPath(renderPath);
+	}
 
 	// Create static scene content. First create a zone for ambient lighting and fog control
 	Node* zoneNode = scene_->CreateChild("Zone");
 	Zone* zone = zoneNode->CreateComponent<Zone>();
+	zone_ = zone;
 	zone->SetAmbientColor(Color(0.15f, 0.15f, 0.15f));
 	zone->SetFogColor(Color(0.25f, 0.3f, 0.31f));
 	zone->SetFogStart(20.0f);
@@ -221,6 +476,7 @@ void MainScene::CreateScene()
 	light->SetShadowBias(BiasParameters(0.00025f, 0.7f));
 	light->SetShadowCascade(CascadeParameters(10.0f, 50.0f, 200.0f, 0.0f, 0.8f));
 	light->SetSpecularIntensity(0.5f);
+	shadowBudget_->SetLight(light);
 
 	// SKY
 	Node* skyNode = scene_->CreateChild("Sky");
@@ -231,22 +487,11 @@ void MainScene::CreateScene()
 
 
 
-	Node* floorNodeX = scene_->CreateChild("Floor");
-	floorNodeX->SetPosition(Vector3(0.0f, -0.5f, 5.0f - 10.0f));
-	floorNodeX->SetScale(Vector3(9.0f, 1.0f, 10.0f));
-	StaticModel* objectX = floorNodeX->CreateComponent<StaticModel>();
-	objectX->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-	objectX->SetMaterial(cache->GetResource<Material>("bin/Data/Materials/Path/pathM2.xml"));
-
-	RigidBody* bodyX = floorNodeX->CreateComponent<RigidBody>();
-	// Use collision layer bit 2 to mark world scenery. This is what we will raycast against to prevent camera from going
-	// inside geometry
-	bodyX->SetCollisionLayer(2);
-	CollisionShape* shapeX = floorNodeX->CreateComponent<CollisionShape>();
-	shapeX->SetBox(Vector3::ONE);
-
+	// All run content is created below this node, one child per segment, so a restart only has to clear it
+	segmentsNode_ = scene_->CreateChild("Segments");
 
 	Node* efekt = scene_->CreateChild("Efekt");
+	efektNode_ = efekt;
 	efekt->SetPosition(Vector3(0.0f, 1.0f, 100.0f));
 	efekt->SetScale(Vector3(10.0f, 5.0f, 1.0f));
 	ParticleEmitter* emitter = efekt->CreateComponent<ParticleEmitter>();
@@ -254,377 +499,204 @@ void MainScene::CreateScene()
 
 	StaticModel* object = efekt->CreateComponent<StaticModel>(LOCAL);
 
+	// Effect voices live on the scene root, resolve the sounds once here instead of on every pickup
+	soundPool_->CreateVoices(scene_);
+	soundPool_->SetEffect(SOUND_COLLECT, cache->GetResource<Sound>("bin/Data/Sounds/collect.wav"), 4);
+	soundPool_->SetEffect(SOUND_HIT, cache->GetResource<Sound>("bin/Data/Sounds/Hard_hit.wav"), 1);
 
-	CreateFloor(cache, level_);
-	CreateCollectibles(cache, level_);
-	CreateObstacles(cache, level_);
+	ApplyQuality();
+}
 
+void MainScene::ApplyQuality() {
+	const QualityLevel& quality = qualityGovernor_->GetSettings();
 
-	PlayMusic(cache);
+	Renderer* renderer = GetSubsystem<Renderer>();
+	if (renderer)
+	{
+		renderer->SetShadowMapSize(quality.shadowMapSize_);
+		renderer->SetOcclusionBufferSize(quality.occlusionBufferSize_);
 
-}
+		RenderPath* renderPath = renderer->GetViewport(0)->GetRenderPath();
+		renderPath->SetEnabled("Bloom", quality.bloom_);
+		renderPath->SetEnabled("FXAA2", quality.fxaa_);
+	}
+	shadowBudget_->SetNumSplits(quality.numCascades_);
 
-void MainScene::PlayMusic(ResourceCache* cache) {
-	// Create music sound source
-	musicSource_ = scene_->CreateComponent<SoundSource>();
-	// Set the sound type to music so that master volume control works correctly
-	musicSource_->SetSoundType(SOUND_MUSIC);
+	zone_->SetFogStart(quality.viewDistance_ * 0.2f);
+	zone_->SetFogEnd(quality.viewDistance_);
+	UpdateViewDistance();
 
-	Sound* music = cache->GetResource<Sound>("bin/Data/Sounds/Escape.wav");
-	// Set the song to loop
-	music->SetLooped(true);
+	// Applies to the segments created from now on
+	startTemplate_->SetDecorationDensity(quality.decorationDensity_);
+	segmentTemplate_->SetDecorationDensity(quality.decorationDensity_);
+}
 
-	musicSource_->Play(music);
-	musicSource_->SetGain(0.25f);
+void MainScene::UpdateViewDistance() {
+	// Past the fog end everything has the fog color, so nothing beyond it needs to be drawn
+	float fogEnd = zone_->GetFogEnd();
+	camera_.Get(cameraNode_)->SetFarClip(fogEnd);
+	treeImpostors_->SetDistances(Min(IMPOSTOR_DISTANCE, fogEnd * 0.5f), fogEnd);
 }
 
-void MainScene::PlaySound(ResourceCache* cache, int type) {
-	Sound* sound;
-	if (type == 0) {
-		sound = cache->GetResource<Sound>("bin/Data/Sounds/collect.wav");
-	}
-	else if (type == 1) {
-		sound = cache->GetResource<Sound>("bin/Data/Sounds/Hard_hit.wav");
+float MainScene::GetStreamingHorizon() const {
+	// A segment has to be built before its start comes out of the fog, with a lead for the distance covered meanwhile
+	RigidBody* body = characterBody_.Get(character_->GetNode());
+	float speed = body ? Max(body->GetLinearVelocity().z_, 0.0f) : 0.0f;
+	return zone_->GetFogEnd() + speed * SEGMENT_BUILD_LEAD_TIME;
+}
+
+void MainScene::PlayMusic(ResourceCache* cache) {
+	// A single music voice is kept for the whole session on a node outside the scene, so that rebuilding the scene
+	// or unpausing never creates another SoundSource
+	if (!musicSource_)
+	{
+		musicNode_ = new Node(context_);
+		musicSource_ = musicNode_->CreateComponent<SoundSource>();
+		// Set the sound type to music so that master volume control works correctly
+		musicSource_->SetSoundType(SOUND_MUSIC);
+		musicSource_->SetGain(0.25f);
 	}
+	else
+		musicSource_->Stop();
 
-	if (sound)
+	// The Ogg Vorbis file stays compressed in memory and is decoded on the fly into the voice's small stream buffer
+	Sound* music = cache->GetResource<Sound>(MUSIC_FILE);
+	SharedPtr<SoundStream> stream = music ? music->GetDecoderStream() : SharedPtr<SoundStream>();
+	if (!stream)
 	{
-		SoundSource* soundSource = scene_->CreateComponent<SoundSource>();
-		// Component will automatically remove itself when the sound finished playing
-		soundSource->SetAutoRemoveMode(REMOVE_COMPONENT);
-		soundSource->Play(sound);
-		//soundSource->SetGain(0.75f);
+		GAME_LOG(LOGCAT_AUDIO, LOG_WARNING, "Music %s could not be streamed, playing without music", MUSIC_FILE);
+		return;
 	}
+
+	// Set the song to loop, the decoder stream rewinds by itself at the end
+	music->SetLooped(true);
+	musicSource_->Play(stream);
 }
 
-void MainScene::CreateFloor(ResourceCache* cache, int level) {
+void MainScene::PauseMusic(bool pause) {
+	// Pause keeps the playback position of the music voice, unlike Stop
+	Audio* audio = GetSubsystem<Audio>();
+	if (pause)
+		audio->PauseSoundType(SOUND_MUSIC);
+	else
+		audio->ResumeSoundType(SOUND_MUSIC);
+}
 
-	// Create the floor object
-	for (unsigned i = 0; i < NUM_FLOOR; i++)
-	{
-		Node* floorNode = scene_->CreateChild("Floor" + level);
-		floorNode->SetPosition(Vector3(0.0f, -0.5f, 5.0f + 10.0f * i + 100.0f * level));
-		floorNode->SetScale(Vector3(9.0f, 1.0f, 10.0f));
-		StaticModel* object = floorNode->CreateComponent<StaticModel>();
-		object->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-		object->SetMaterial(cache->GetResource<Material>("bin/Data/Materials/Path/pathM2.xml"));
-
-		RigidBody* body = floorNode->CreateComponent<RigidBody>();
-		// Use collision layer bit 2 to mark world scenery. This is what we will raycast against to prevent camera from going
-		// inside geometry
-		body->SetCollisionLayer(2);
-		CollisionShape* shape = floorNode->CreateComponent<CollisionShape>();
-		shape->SetBox(Vector3::ONE);
-
-		Node* landscapeNode = scene_->CreateChild("LandscapeRight"+level);
-		landscapeNode->SetPosition(Vector3(10.0f / 2 + 4.5f, -0.5f, 5.0f + 10.0f * i + 100.0f * level));
-		landscapeNode->SetScale(Vector3(10.0f, 1.0f, 10.0f));
-		StaticModel* landscapeObject = landscapeNode->CreateComponent<StaticModel>();
-		landscapeObject->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-		landscapeObject->SetMaterial(cache->GetResource<Material>("bin/Data/Materials/Path/grass.xml"));
-		Node* landscapeNode2 = scene_->CreateChild("LandscapeRight"+ level);
-		landscapeNode2->SetPosition(Vector3(10.0f / 2 + 10.0f + 4.5f, -0.5f, 5.0f + 10.0f * i + 100.0f * level));
-		landscapeNode2->SetScale(Vector3(10.0f, 1.0f, 10.0f));
-		StaticModel* landscapeObject2 = landscapeNode2->CreateComponent<StaticModel>();
-		landscapeObject2->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-		landscapeObject2->SetMaterial(cache->GetResource<Material>("bin/Data/Materials/Path/grass.xml"));
-
-		float randomScale = Random(0.5f) + 1.0f;
-		float randomTree = Random(2.0f);
-		Node* treeNode = scene_->CreateChild("Tree" + level);
-		treeNode->SetPosition(Vector3(Random(8.0f) + 6.0f, -0.5f, 5.0f + 10.0f * i + 100.0f * level));
-		treeNode->SetScale(Vector3(randomScale, randomScale, randomScale));
-		StaticModel* treeObject = treeNode->CreateComponent<StaticModel>();
-		if (randomTree < 0.5f) {
-			treeObject->SetModel(cache->GetResource<Model>("bin/Data/Models/tree3/tree.mdl"));
-			treeObject->SetMaterial(cache->GetResource<Material>("bin/Data/Materials/torch_wood.xml"));
-			treeObject->SetCastShadows(true);
-			treeObject = treeNode->CreateComponent<StaticModel>();
-			treeObject->SetModel(cache->GetResource<Model>("bin/Data/Models/tree3/leaves.mdl"));
-			treeObject->SetMaterial(cache->GetResource<Material>("bin/Data/Models/tree3/Material.004.xml"));
-			treeObject->SetCastShadows(true);
-		}
-		else {
-			treeObject->SetModel(cache->GetResource<Model>("bin/Data/Models/tree2/tree.mdl"));
-			treeObject->SetMaterial(cache->GetResource<Material>("bin/Data/Materials/torch_wood.xml"));
-			treeObject->SetCastShadows(true);
-			treeObject = treeNode->CreateComponent<StaticModel>();
-			treeObject->SetModel(cache->GetResource<Model>("bin/Data/Models/tree2/leaves.mdl"));
-			treeObject->SetMaterial(cache->GetResource<Material>("bin/Data/Models/tree3/Material.004.xml"));
-			treeObject->SetCastShadows(true);
+void MainScene::PlaySound(SoundEffect effect) {
+	// Voices are pre-created, so playing an effect never creates or removes components
+	soundPool_->Play(effect);
+}
 
-		}
-		
-		Node* landscapeNodeLeft = scene_->CreateChild("LandscapeLeft"+level);
-		landscapeNodeLeft->SetPosition(Vector3(-(10.0f / 2 + 4.5f), -0.5f, 5.0f + 10.0f * i + 100.0f * level));
-		landscapeNodeLeft->SetScale(Vector3(10.0f, 1.0f, 10.0f));
-		StaticModel* landscapeObjectLeft = landscapeNodeLeft->CreateComponent<StaticModel>();
-		landscapeObjectLeft->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-		landscapeObjectLeft->SetMaterial(cache->GetResource<Material>("bin/Data/Materials/Path/grass.xml"));
-		Node* landscapeNodeLeft2 = scene_->CreateChild("LandscapeLeft"+ level);
-		landscapeNodeLeft2->SetPosition(Vector3(-(10.0f / 2 + 10.0f + 4.5f), -0.5f, 5.0f + 10.0f * i + 100.0f * level));
-		landscapeNodeLeft2->SetScale(Vector3(10.0f, 1.0f, 10.0f));
-		StaticModel* landscapeObjectLeft2 = landscapeNodeLeft2->CreateComponent<StaticModel>();
-		landscapeObjectLeft2->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-		landscapeObjectLeft2->SetMaterial(cache->GetResource<Material>("bin/Data/Materials/Path/grass.xml"));
-
-
-		float randomScale2 = Random(0.2f) + 1.0f;
-		Node* treeNode2 = scene_->CreateChild("Tree" + level);
-		treeNode2->SetPosition(Vector3(-(Random(8.0f) + 6.0f), -0.5f, 5.0f + 10.0f * i + 100.0f * level));
-		treeNode2->SetScale(Vector3(randomScale, randomScale, randomScale));
-		StaticModel* treeObject2 = treeNode2->CreateComponent<StaticModel>();
-		treeObject2->SetModel(cache->GetResource<Model>("bin/Data/Models/tree2/tree.mdl"));
-		treeObject2->SetMaterial(cache->GetResource<Material>("bin/Data/Materials/torch_wood.xml"));
-		treeObject2->SetCastShadows(true);
-		treeObject2 = treeNode2->CreateComponent<StaticModel>();
-		treeObject2->SetModel(cache->GetResource<Model>("bin/Data/Models/tree2/leaves.mdl"));
-		treeObject2->SetMaterial(cache->GetResource<Material>("bin/Data/Models/tree2/Material.004.xml"));
-		treeObject2->SetCastShadows(true);
-
-		/////////////////////////////////////
-		Node* leftWallNode = scene_->CreateChild("LeftWall" + level);
-		leftWallNode->SetPosition(Vector3(-4.0f, 2.0f, 5.0f + 10.0f * i + 100.0f * level));
-		leftWallNode->SetScale(Vector3(1.0f, 4.0f, 10.0f));
-		StaticModel* object2 = leftWallNode->CreateComponent<StaticModel>();
-		object2->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-		object2->SetMaterial(cache->GetResource<Material>("Materials/Smoke.xml"));
-
-		RigidBody* body2 = leftWallNode->CreateComponent<RigidBody>();
-		body2->SetCollisionLayer(2);
-		CollisionShape* shape2 = leftWallNode->CreateComponent<CollisionShape>();
-		shape2->SetBox(Vector3::ONE);
-
-		Node* rightWallNode = scene_->CreateChild("RightWall" + level);
-		rightWallNode->SetPosition(Vector3(4.0f, 2.0f, 5.0f + 10.0f * i + 100.0f * level));
-		rightWallNode->SetScale(Vector3(1.0f, 4.0f, 10.0f));
-		StaticModel* object3 = rightWallNode->CreateComponent<StaticModel>();
-		object3->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-		object3->SetMaterial(cache->GetResource<Material>("Materials/Smoke.xml"));
-
-		RigidBody* body3 = rightWallNode->CreateComponent<RigidBody>();
-		body3->SetCollisionLayer(2);
-		CollisionShape* shape3 = rightWallNode->CreateComponent<CollisionShape>();
-		shape3->SetBox(Vector3::ONE);
-	}
+Node* MainScene::GetSegmentNode(int level) {
+	String name = "Segment" + String(level);
+	Node* segment = segmentsNode_->GetChild(name);
+	if (!segment)
+		segment = segmentsNode_->CreateChild(name);
+	return segment;
+}
 
+void MainScene::StreamSegments() {
+	GAME_PROFILE(StreamSegments);
 
-}
+	ResourceCache* cache = GetSubsystem<ResourceCache>();
+	Node* characterNode = character_->GetNode();
 
+	//// Usuwanie sciezki, ktora bohater juz przeszedl
+	if (characterNode->GetPosition().z_ > 100.0f * (currentLevel_+ 1)) {
+		DeleteFloor(currentLevel_);
+		
+		currentLevel_ += 1;
+		character_->speed_ += 0.1;
 
-void MainScene::DeleteFloor(int level) {
-	for (int i = 0; i < NUM_FLOOR; i++) {
-		Node* removeNode = scene_->GetChild("Floor");
-		scene_->RemoveChild(removeNode);
-		removeNode = scene_->GetChild("Floor" + level);
-		scene_->RemoveChild(removeNode);
-		removeNode = scene_->GetChild("LandscapeRight" + level);
-		scene_->RemoveChild(removeNode);
-		removeNode = scene_->GetChild("LandscapeLeft" + level);
-		scene_->RemoveChild(removeNode);
-		removeNode = scene_->GetChild("LeftWall" + level);
-		scene_->RemoveChild(removeNode);
-		removeNode = scene_->GetChild("RightWall" + level);
-		scene_->RemoveChild(removeNode);
-		removeNode = scene_->GetChild("Tree" + level);
-		scene_->RemoveChild(removeNode);
+		// Checkpoint at every segment boundary, used by "Continue" after game over
+		TakeSnapshot(checkpoint_);
 	}
-	for (int i = 0; i < NUM_BOXES; i++) {
-		Node* removeNode = scene_->GetChild("Box" + level);
-		scene_->RemoveChild(removeNode);
+	//// Tworzenie nowej cieki
+	if (characterNode->GetPosition().z_ + GetStreamingHorizon() >= 100.0f * (level_ + 1)) {
+		CreateSegment(cache, level_ + 1);
+		level_ += 1;
 	}
-	for (int i = 0; i < NUM_CARROTS; i++) {
-		Node* removeNode = scene_->GetChild("Carrot" + level);
-		scene_->RemoveChild(removeNode);
-		removeNode = scene_->GetChild("Effects" + level);
-		scene_->RemoveChild(removeNode);
-	}
-	
 }
 
-void MainScene::CreateObstacles(ResourceCache* cache, int level) {
+void MainScene::CreateSegment(ResourceCache* cache, int level) {
+	GAME_PROFILE(CreateSegment);
 
-	if (level == 0) {
-		int nr = 6;
-		for (unsigned i = 0; i < nr; ++i)
-		{
-			Node* objectNode = scene_->CreateChild("Obstacle" + level);
-			objectNode->SetPosition(Vector3((int(Random(3.0f)) - 1.0f) * 2.5, 0.0f, 40.0f + int(i * 60 / nr) + 100.0f * level));
-			std::cout << objectNode->GetPosition().z_ << std::endl;
-			//objectNode->SetRotation(Quaternion(0.0f, 0.0f, 0.0f));
-			//objectNode->SetScale(Vector3(1.5f, 1.5f, 0.2f));
-			StaticModel* object5 = objectNode->CreateComponent<StaticModel>();
-			object5->SetModel(cache->GetResource<Model>("bin/Data/Models/skala/Models/Skala_low_poly_B.mdl"));
-			object5->SetMaterial(cache->GetResource<Material>("Materials/Stone.xml"));
-			object5->SetCastShadows(true);
-
-			RigidBody* body5 = objectNode->CreateComponent<RigidBody>();
-			body5->SetCollisionLayer(3);
-			// Bigger boxes will be heavier and harder to move
-			//body5->SetMass(20.0f);
-			CollisionShape* shape5 = objectNode->CreateComponent<CollisionShape>();
-			shape5->SetBox(Vector3::ONE);
-		}
-	}
-	else {
-		if (level % 5 && NUM_BOXES > 2) {
-			NUM_BOXES -= 1;
-		}
+	// Every segment draws from its own seed, so its layout does not depend on how many random numbers were consumed
+	// elsewhere (particles etc.) and a run with the same seed always produces the same track
+	SetRandomSeed(runSeed_ + level * 7919);
+	HiresTimer buildTimer;
 
-		for (unsigned i = 0; i < NUM_BOXES; ++i)
-		{
-			int randObstacles = int(Round(Random(2.4f)));
-			if (prevObstaclesNr == 0 && randObstacles == 0) {
-				randObstacles = int(Round(Random(2.4f)));
-			}
-			std::cout << randObstacles << std::endl;
-			prevObstaclesNr = randObstacles;
-
-
-			if (randObstacles == 0) {
-				Node* deadTreeNode = scene_->CreateChild("Obstacle" + level);
-				deadTreeNode->SetPosition(Vector3(4.5, 0.2f, int(i * 100 / NUM_BOXES) + 100.0f * level));
-				deadTreeNode->SetRotation(Quaternion(0.0f, -90.0f, 0.0f));
-				//deadTreeNode->SetScale(Vector3(0.5f, 0.5f, 0.5f));
-				StaticModel* deadTree = deadTreeNode->CreateComponent<StaticModel>();
-				deadTree->SetModel(cache->GetResource<Model>("bin/Data/Models/dead_tree/tree.mdl"));
-				deadTree->SetMaterial(cache->GetResource<Material>("bin/Data/Models/dead_tree/bark.xml"));
-				deadTree->SetCastShadows(true);
-
-				RigidBody* deadTreeBody = deadTreeNode->CreateComponent<RigidBody>();
-				deadTreeBody->SetCollisionLayer(3);
-				// Bigger boxes will be heavier and harder to move
-				//deadTreeBody->SetMass(10.0f);
-				CollisionShape* deadTreeShape = deadTreeNode->CreateComponent<CollisionShape>();
-				deadTreeShape->SetTriangleMesh(deadTree->GetModel(), 0);
+	SegmentDescriptor descriptor;
+	descriptor.level_ = level;
+	descriptor.numBoxes_ = numBoxes_;
+	descriptor.prevObstaclesNr_ = prevObstaclesNr_;
+	descriptor.carrots_ = 0;
+	segments_.Push(descriptor);
 
-			}
-			else if (randObstacles == 1) {
+	CreateFloor(cache, level);
+	CreateCollectibles(cache, level);
+	CreateObstacles(cache, level);
 
-				int randLine1 = int(Random(3.0f));
-				int randLine2 = int(Random(3.0f));
-				while (randLine1 == randLine2) {
-					randLine2 = int(Random(3.0f));
-				}
+	GAME_LOG(LOGCAT_GENERATION, LOG_DEBUG, "Segment %d built in %.2f ms", level, buildTimer.GetUSec(false) / 1000.0f);
+}
 
-				Node* objectNode = scene_->CreateChild("Obstacle" + level);
-				objectNode->SetPosition(Vector3((randLine1 - 1.0f) * 2.5, 0.0f, int(i * 100 / NUM_BOXES) + 100.0f * level));
-				std::cout << objectNode->GetPosition().z_ << std::endl;
-				//objectNode->SetRotation(Quaternion(0.0f, 0.0f, 0.0f));
-				//objectNode->SetScale(Vector3(1.5f, 1.5f, 0.2f));
-				StaticModel* object5 = objectNode->CreateComponent<StaticModel>();
-				object5->SetModel(cache->GetResource<Model>("bin/Data/Models/skala/Models/Skala_low_poly_B.mdl"));
-				object5->SetMaterial(cache->GetResource<Material>("Materials/Stone.xml"));
-				object5->SetCastShadows(true);
-
-				RigidBody* body5 = objectNode->CreateComponent<RigidBody>();
-				body5->SetCollisionLayer(3);
-				// Bigger boxes will be heavier and harder to move
-				//body5->SetMass(20.0f);
-				CollisionShape* shape5 = objectNode->CreateComponent<CollisionShape>();
-				shape5->SetBox(Vector3::ONE);
-
-				Node* objectNode2 = scene_->CreateChild("Obstacle" + level);
-				objectNode2->SetPosition(Vector3((randLine2 - 1.0f) * 2.5, 0.0f, int(i * 100 / NUM_BOXES) + 100.0f * level));
-				std::cout << objectNode2->GetPosition().z_ << std::endl;
-				//objectNode->SetRotation(Quaternion(0.0f, 0.0f, 0.0f));
-				//objectNode->SetScale(Vector3(1.5f, 1.5f, 0.2f));
-				StaticModel* object2 = objectNode2->CreateComponent<StaticModel>();
-				object2->SetModel(cache->GetResource<Model>("bin/Data/Models/skala/Models/Skala_low_poly_B.mdl"));
-				object2->SetMaterial(cache->GetResource<Material>("Materials/Stone.xml"));
-				object2->SetCastShadows(true);
-
-				RigidBody* body2 = objectNode2->CreateComponent<RigidBody>();
-				body2->SetCollisionLayer(3);
-				// Bigger boxes will be heavier and harder to move
-				//body5->SetMass(20.0f);
-				CollisionShape* shape2 = objectNode2->CreateComponent<CollisionShape>();
-				shape2->SetBox(Vector3::ONE);
+void MainScene::CreateFloor(ResourceCache* cache, int level) {
+	GAME_PROFILE(CreateFloor);
 
-			}
-			else {
-				Node* objectNode = scene_->CreateChild("Obstacle" + level);
-				objectNode->SetPosition(Vector3((int(Random(3.0f)) - 1.0f) * 2.5, 0.0f, int(i * 100 / NUM_BOXES) + 100.0f * level));
-				std::cout << objectNode->GetPosition().z_ << std::endl;
-				//objectNode->SetRotation(Quaternion(0.0f, 0.0f, 0.0f));
-				//objectNode->SetScale(Vector3(1.5f, 1.5f, 0.2f));
-				StaticModel* object5 = objectNode->CreateComponent<StaticModel>();
-				object5->SetModel(cache->GetResource<Model>("bin/Data/Models/skala/Models/Skala_low_poly_B.mdl"));
-				object5->SetMaterial(cache->GetResource<Material>("Materials/Stone.xml"));
-				object5->SetCastShadows(true);
-
-				RigidBody* body5 = objectNode->CreateComponent<RigidBody>();
-				body5->SetCollisionLayer(3);
-				// Bigger boxes will be heavier and harder to move
-				//body5->SetMass(20.0f);
-				CollisionShape* shape5 = objectNode->CreateComponent<CollisionShape>();
-				shape5->SetBox(Vector3::ONE);
-			}
+	Node* segment = GetSegmentNode(level);
+	GetSegmentTemplate(level)->CreateScenery(segment, 100.0f * level);
+	staticBatcher_->Bake(segment);
+	treeImpostors_->AddSegment(segment);
+}
+
+void MainScene::DeleteFloor(int level) {
+	GAME_PROFILE(DeleteFloor);
+
+	// Everything the segment spawned (floor, scenery, obstacles, carrots and effects) is below its segment node
+	Node* segment = segmentsNode_->GetChild("Segment" + String(level));
+	if (segment)
+		segment->Remove();
+
+	for (unsigned i = 0; i < segments_.Size(); ++i)
+	{
+		if (segments_[i].level_ == level)
+		{
+			segments_.Erase(i);
+			break;
 		}
 	}
 }
 
-void MainScene::CreateCollectibles(ResourceCache* cache, int level) {
+void MainScene::CreateObstacles(ResourceCache* cache, int level) {
+	GAME_PROFILE(CreateObstacles);
+
+	Node* segment = GetSegmentNode(level);
+
 	if (level == 0) {
-		int nr = 9;
-		for (unsigned i = 0; i < nr; ++i)
-		{
-			int randomPosX = int(Random(3.0f));
-			Node* carrotNode = scene_->CreateChild("Carrot" + level);
-			carrotNode->SetPosition(Vector3((randomPosX - 1.0f) * 2.5, 1.5f, 10.0f + int(i * 90 / nr) + 100.0f * level));
-			carrotNode->SetRotation(Quaternion(0.0f, 0.0f, 160.0f));
-			carrotNode->SetScale(0.2f);
-			StaticModel* carrot = carrotNode->CreateComponent<StaticModel>();
-			carrot->SetModel(cache->GetResource<Model>("bin/Data/Models/marchewka/Models/marchewka.mdl"));
-			carrot->SetMaterial(cache->GetResource<Material>("bin/Data/Models/marchewka/Materials/orange.xml"));
-			carrot->SetCastShadows(true);
-
-			RigidBody* carrotBody = carrotNode->CreateComponent<RigidBody>();
-			carrotBody->SetCollisionLayer(4);
-			carrotBody->SetTrigger(true);
-			CollisionShape* carrotShape = carrotNode->CreateComponent<CollisionShape>();
-			carrotShape->SetBox(Vector3::ONE);
-
-			Node* efekt = scene_->CreateChild("Effects" + level);
-			efekt->SetPosition(Vector3((randomPosX - 1.0f) * 2.5, 0.0f, 20.0f + int(i * 80 / nr) + 100.0f * level));
-			efekt->SetScale(Vector3(1.0f, 0.2f, 1.0f));
-			ParticleEmitter* emitter = efekt->CreateComponent<ParticleEmitter>();
-			emitter->SetEffect(cache->GetResource<ParticleEffect>("bin/Data/Particle/torch_fire.xml"));
-
-			StaticModel* object = efekt->CreateComponent<StaticModel>(LOCAL);
-		}
+		prevObstaclesNr_ = startTemplate_->CreateObstacles(segment, 0.0f, startTemplate_->GetObstacleRows(), prevObstaclesNr_);
 	}
 	else {
-
-		for (unsigned i = 0; i < NUM_CARROTS; ++i)
-		{
-			int randomPosX = int(Random(3.0f));
-			Node* carrotNode = scene_->CreateChild("Carrot" + level);
-			carrotNode->SetPosition(Vector3((randomPosX - 1.0f) * 2.5, 1.5f, int(i * 100 / NUM_CARROTS) + 100.0f * level));
-			carrotNode->SetRotation(Quaternion(0.0f, 0.0f, 160.0f));
-			carrotNode->SetScale(0.2f);
-			StaticModel* carrot = carrotNode->CreateComponent<StaticModel>();
-			carrot->SetModel(cache->GetResource<Model>("bin/Data/Models/marchewka/Models/marchewka.mdl"));
-			carrot->SetMaterial(cache->GetResource<Material>("bin/Data/Models/marchewka/Materials/orange.xml"));
-			carrot->SetCastShadows(true);
-
-			RigidBody* carrotBody = carrotNode->CreateComponent<RigidBody>();
-			carrotBody->SetCollisionLayer(4);
-			carrotBody->SetTrigger(true);
-			CollisionShape* carrotShape = carrotNode->CreateComponent<CollisionShape>();
-			carrotShape->SetBox(Vector3::ONE);
-
-			Node* efekt = scene_->CreateChild("Effects" + level);
-			efekt->SetPosition(Vector3((randomPosX - 1.0f) * 2.5, 0.0f, int(i * 100 / NUM_CARROTS) + 100.0f * level));
-			efekt->SetScale(Vector3(1.0f, 0.2f, 1.0f));
-			ParticleEmitter* emitter = efekt->CreateComponent<ParticleEmitter>();
-			emitter->SetEffect(cache->GetResource<ParticleEffect>("bin/Data/Particle/torch_fire.xml"));
-
-			StaticModel* object = efekt->CreateComponent<StaticModel>(LOCAL);
+		// Rows get sparser as the run goes on, so the player has more time to react at the higher speed
+		if (level % 5 && numBoxes_ > (int)segmentTemplate_->GetMinObstacleRows()) {
+			numBoxes_ -= 1;
 		}
+
+		prevObstaclesNr_ = segmentTemplate_->CreateObstacles(segment, 100.0f * level, numBoxes_, prevObstaclesNr_);
 	}
+}
+
+void MainScene::CreateCollectibles(ResourceCache* cache, int level) {
+	GAME_PROFILE(CreateCollectibles);
 
+	Node* segment = GetSegmentNode(level);
+	GetSegmentTemplate(level)->CreateCollectibles(segment, 100.0f * level);
+	shadowBudget_->Apply(collectibleGlow_->AddSegment(segment), CATEGORY_EFFECT);
 }
+
+SegmentTemplate* MainScene::GetSegmentTemplate(int level) const {
+	return level == 0 ? startTemplate_ : segmentTemplate_;
+}
+
 void MainScene::CreateCharacter() {
 	ResourceCache* cache = GetSubsystem<ResourceCache>();
 
@@ -638,6 +710,7 @@ void MainScene::CreateCharacter() {
 	object->SetModel(cache->GetResource<Model>("bin/Data/Models/kach/Kachujin.mdl"));
 	object->SetMaterial(cache->GetResource<Material>("bin/Data/Models/kach/kachujin_MAT.xml"));
 	object->SetCastShadows(true);
+	shadowBudget_->Apply(objectNode, CATEGORY_CHARACTER);
 	objectNode->CreateComponent<AnimationController>();
 
 	// Set the head bone for manual control
@@ -664,11 +737,9 @@ void MainScene::CreateCharacter() {
 	// Remember it so that we can set the controls. Use a WeakPtr because the scene hierarchy already owns it
 	// and keeps it alive as long as it's not removed from the hierarchy
 	character_ = objectNode->CreateComponent<Character>();
-	//////////////////
-
-	File saveFile(context_, GetSubsystem<FileSystem>()->GetProgramDir() + "Data/Scenes/GameScene.xml", FILE_WRITE);
-	scene_->SaveXML(saveFile);
-	std::cout << "SAAAAAAAAAAAAAAAVE" << std::endl;
+	character_->SetTouch(touch_);
+	character_->SetLatencyTracer(latencyTracer_);
+	character_->SetInputQueue(inputQueue_);
 }
 
 
@@ -688,12 +759,12 @@ void MainScene::SubscribeToEvents()
 }
 void MainScene::GameOver(){
 	////////////// GAME OVER /////////////////////
-	musicSource_->Stop();
+	if (musicSource_)
+		musicSource_->Stop();
 	scene_->SetUpdateEnabled(false);
 	gameOver_ = true;
 	gamePaused_ = true;
 	
-	//std::cout << character_->gameOver_ << std::endl;
 	UI* ui = GetSubsystem<UI>();
 
 	ResourceCache* cache = GetSubsystem<ResourceCache>();
@@ -704,7 +775,10 @@ void MainScene::GameOver(){
 	ui->GetRoot()->AddChild(layoutRoot);
 	// Subscribe to button actions (toggle scene lights when pressed then released)
 
-	Button* button = layoutRoot->GetChildStaticCast<Button>("PlayGame", true);
+	Button* button = layoutRoot->GetChildStaticCast<Button>("Continue", true);
+	if (button)
+		SubscribeToEvent(button, E_RELEASED, URHO3D_HANDLER(MainScene, ContinueGame));
+	button = layoutRoot->GetChildStaticCast<Button>("PlayGame", true);
 	if (button)
 		SubscribeToEvent(button, E_RELEASED, URHO3D_HANDLER(MainScene, PlayGame));
 	button = layoutRoot->GetChildStaticCast<Button>("Quit", true);
@@ -736,57 +810,78 @@ void MainScene::UpdateCollected() {
 	textCollectible_->SetText(s);
 }
 
+void MainScene::UpdateStats() {
+	String stats = "Shadow batches:";
+	for (unsigned i = 0; i < shadowBudget_->GetNumSplits(); ++i)
+		stats.AppendWithFormat(" %u (%d m)", shadowBudget_->GetNumShadowBatches(i), (int)Round(shadowBudget_->GetSplit(i)));
+	if (latencyTracer_->GetNumTraces())
+		stats.AppendWithFormat("\nInput to frame: median %d ms, 95%% %d ms",
+			(int)Round(latencyTracer_->GetPercentile(LATENCY_PRESENTED, 0.5f)),
+			(int)Round(latencyTracer_->GetPercentile(LATENCY_PRESENTED, 0.95f)));
+	if (touch_)
+		stats.AppendWithFormat("\nTouch latency: %f ms (max %f ms)", touch_->GetLatency(), touch_->GetMaxLatency());
+	stats.AppendWithFormat("\nCamera queries saved: %u/s", cameraCollision_->GetQueriesSaved());
+	stats.AppendWithFormat("\nOccluders: %u, culled %u drawables (%u batches)", occlusionStats_->GetNumOccluders(),
+		occlusionStats_->GetNumCulled(), occlusionStats_->GetNumCulledBatches());
+	if (staticBatcher_->IsEnabled())
+		stats.AppendWithFormat("\nBaked: %u drawables into %u (%u KB)", staticBatcher_->GetNumRemoved(),
+			staticBatcher_->GetNumCreated(), staticBatcher_->GetNumBytes() / 1024);
+	if (traceProfiler_->IsRecording())
+		stats.Append("\nRecording trace (F9 to stop)");
+	textStats_->SetText(stats);
+}
+
 void MainScene::Collect() {
 
 }
 
 void MainScene::HandleUpdate(StringHash eventType, VariantMap& eventData)
 {
+	GAME_PROFILE(HandleUpdate);
 
 	using namespace Update;
 
 	Input* input = GetSubsystem<Input>();
 
+	// Only frames of the running game are representative of the load
+	if (!gamePaused_ && qualityGovernor_->Update(eventData[P_TIMESTEP].GetFloat()))
+		ApplyQuality();
 
 	if (character_)
 	{
-		ResourceCache* cache = GetSubsystem<ResourceCache>();
 		Node* characterNode = character_->GetNode();
 
 		if (character_->gameOver_ == true) {
-			PlaySound(cache, 1);
+			PlaySound(SOUND_HIT);
 			GameOver();
 			character_->gameOver_ = false;
 		}
 		else {
-			Node* efekt = scene_->GetChild("Efekt");
-			efekt->SetPosition(Vector3(0.0f, 0.0f, characterNode->GetPosition().z_ + 99.0f));
+			efektNode_->SetPosition(Vector3(0.0f, 0.0f, characterNode->GetPosition().z_ + 99.0f));
 			
 
 
 			if (character_->playCollectSound_ == true) {
-				PlaySound(cache, 0);
+				PlaySound(SOUND_COLLECT);
 				character_->playCollectSound_ = false;
 			}
-			//// Usuwanie sciezki, ktora bohater juz przeszedl
-			if (characterNode->GetPosition().z_ > 100.0f * (currentLevel_+ 1)) {
-				DeleteFloor(currentLevel_);
-				
-				currentLevel_ += 1;
-				character_->speed_ += 0.1;
-				
-			}
-			//// Tworzenie nowej cieki
-			if (characterNode->GetPosition().z_ >= 100.0f * (level_) + 20.0f) {
-				//level_ += 1;
-				CreateFloor(cache, level_+ 1);
-				CreateCollectibles(cache, level_+ 1);
-				CreateObstacles(cache, level_+1);
-				level_ += 1;
-			}
+			StreamSegments();
 			if (gamePaused_ == false) {
 				UpdateScore();
 				UpdateCollected();
+				UpdateStats();
+
+				collectibleGlow_->Update(eventData[P_TIMESTEP].GetFloat(), cameraNode_->GetWorldPosition());
+
+				// Periodic save of the run, serialized here and written to disk by the writer thread
+				autosaveTimer_ += eventData[P_TIMESTEP].GetFloat();
+				if (autosaveTimer_ >= AUTOSAVE_INTERVAL)
+				{
+					autosaveTimer_ = 0.0f;
+					RunSnapshot autosave;
+					TakeSnapshot(autosave);
+					snapshotWriter_->Queue(autosave);
+				}
 			}
 			
 
@@ -813,21 +908,10 @@ void MainScene::HandleUpdate(StringHash eventType, VariantMap& eventData)
 
 
 
-		// Update controls using keys
+		// Control keys go through the input queue, the character consumes their edges one fixed step at a time
 		UI* ui = GetSubsystem<UI>();
 		if (!ui->GetFocusElement())
 		{
-			if (!touch_ || !touch_->useGyroscope_)
-			{
-
-				character_->controls_.Set(CTRL_FORWARD, input->GetKeyDown(KEY_W));
-				character_->controls_.Set(CTRL_BACK, input->GetKeyDown(KEY_DOWN));
-				character_->controls_.Set(CTRL_LEFT, input->GetKeyDown(KEY_LEFT));
-				character_->controls_.Set(CTRL_RIGHT, input->GetKeyDown(KEY_RIGHT));
-			}
-			character_->controls_.Set(CTRL_JUMP, input->GetKeyDown(KEY_UP));
-
-			
 			////////////////// AUTO chodzenie do przodu
 			////////////character_->controls_.Set(CTRL_FORWARD);
 
@@ -846,9 +930,8 @@ void MainScene::HandleUpdate(StringHash eventType, VariantMap& eventData)
 				ResourceCache* cache = GetSubsystem<ResourceCache>();
 				if (gamePaused_ == false) {
 					gamePaused_ = true;
-					musicSource_->Stop();
+					PauseMusic(true);
 					scene_->SetUpdateEnabled(false);
-					//std::cout << character_->gameOver_ << std::endl;
 					
 					ui->GetRoot()->SetDefaultStyle(cache->GetResource<XMLFile>("bin/Data/UI/DefaultStyle.xml"));
 					gamePausedText_ = new Text(context_);
@@ -861,27 +944,36 @@ void MainScene::HandleUpdate(StringHash eventType, VariantMap& eventData)
 				}
 				else {
 					gamePaused_ = false;
-					PlayMusic(cache);
+					PauseMusic(false);
 					scene_->SetUpdateEnabled(true);
+					// Keys pressed and gestures made while paused do not act on resume
+					inputQueue_->Clear();
+					if (touch_)
+						touch_->ClearGestures();
 					GetSubsystem<UI>()->GetRoot()->RemoveChild(gamePausedText_);
 				}
 				
 			}
 			// Check for loading / saving the scene
+			// Check for taking / restoring a checkpoint. The snapshot only holds gameplay state, the scene itself stays
 			if (input->GetKeyPress(KEY_F5))
 			{
-				File saveFile(context_, GetSubsystem<FileSystem>()->GetProgramDir() + "Data/Scenes/CharacterDemo.xml", FILE_WRITE);
-				scene_->SaveXML(saveFile);
+				TakeSnapshot(checkpoint_);
+				snapshotWriter_->Queue(checkpoint_);
 			}
 			if (input->GetKeyPress(KEY_F7))
+				RestoreSnapshot(checkpoint_);
+			// Toggle baking of the static scenery, takes effect on the next segments
+			if (input->GetKeyPress(KEY_F6))
+				staticBatcher_->SetEnabled(!staticBatcher_->IsEnabled());
+			if (input->GetKeyPress(KEY_F8))
+				latencyTracer_->LogHistograms();
+			if (input->GetKeyPress(KEY_F9))
 			{
-				File loadFile(context_, GetSubsystem<FileSystem>()->GetProgramDir() + "Data/Scenes/CharacterDemo.xml", FILE_READ);
-				scene_->LoadXML(loadFile);
-				// After loading we have to reacquire the weak pointer to the Character component, as it has been recreated
-				// Simply find the character's scene node by name as there's only one of them
-				Node* characterNode = scene_->GetChild("Jack", true);
-				if (characterNode)
-					character_ = characterNode->GetComponent<Character>();
+				if (traceProfiler_->IsRecording())
+					traceProfiler_->StopSession();
+				else
+					traceProfiler_->StartSession(GetSubsystem<FileSystem>()->GetAppPreferencesDir("urho3d", "traces"));
 			}
 		}
 
@@ -891,6 +983,8 @@ void MainScene::HandleUpdate(StringHash eventType, VariantMap& eventData)
 
 void MainScene::HandlePostUpdate(StringHash eventType, VariantMap& eventData)
 {
+	GAME_PROFILE(HandlePostUpdate);
+
 	if (!character_)
 		return;
 
@@ -904,18 +998,16 @@ void MainScene::HandlePostUpdate(StringHash eventType, VariantMap& eventData)
 	// Third person camera: position behind the character
 	Vector3 aimPoint = characterNode->GetPosition() + rot * Vector3(0.0f, 2.8f, -1.1f);
 
-	// Collide camera ray with static physics objects (layer bitmask 2) to ensure we see the character properly
+	// Keep the camera out of the static scenery (layer bitmask 2) to ensure we see the character properly
 	Vector3 rayDir = dir * Vector3::BACK;
 	float rayDistance = touch_ ? touch_->cameraDistance_ : CAMERA_INITIAL_DIST;
-	PhysicsRaycastResult result;
-	scene_->GetComponent<PhysicsWorld>()->RaycastSingle(result, Ray(aimPoint, rayDir), rayDistance, 2);
-	if (result.body_)
-		rayDistance = Min(rayDistance, result.distance_);
+	rayDistance = cameraCollision_->Update(aimPoint, rayDir, rayDistance, eventData[PostUpdate::P_TIMESTEP].GetFloat());
 	rayDistance = Clamp(rayDistance, CAMERA_MIN_DIST, CAMERA_MAX_DIST);
 
 	cameraNode_->SetPosition(aimPoint + rayDir * rayDistance);
 	cameraNode_->SetRotation(dir);
 
+	treeImpostors_->Update(cameraNode_->GetWorldPosition());
 
 }
 
@@ -1,15 +1,38 @@
 #pragma once
 
 #include "App.h"
+#include "ComponentRef.h"
+#include "RunSnapshot.h"
+#include "SoundPool.h"
 
 namespace Urho3D
 {
+	class Camera;
 	class Node;
+	class RigidBody;
 	class Scene;
+	class Zone;
 }
 
+class CameraCollision;
 class Character;
+class CollectibleGlow;
+class GameLog;
+class InputQueue;
+class LatencyTracer;
+class OcclusionStats;
+class QualityGovernor;
+class SegmentTemplate;
+class ShadowBudget;
+class SnapshotWriter;
+class Spawner;
+class StaticBatcher;
 class Touch;
+class TraceProfiler;
+class TreeImpostors;
+
+/// Time it may take from building a segment until its start comes out of the fog, in seconds.
+const float SEGMENT_BUILD_LEAD_TIME = 1.0f;
 
 class MainScene : public App
 {
@@ -21,6 +44,8 @@ public:
 	SharedPtr<Text> text2_;
 	SharedPtr<Text> gameOverText_;
 	SharedPtr<Text> gamePausedText_;
+	/// Render statistics.
+	SharedPtr<Text> textStats_;
 	float time_;
 	int collected_;
 	int level_;
@@ -29,23 +54,57 @@ public:
 	float characterPositionZ;
 	bool gamePaused_;
 	bool gameOver_;
+	/// Number of obstacle rows per segment, decreases as the run goes on.
+	int numBoxes_;
+	/// Obstacle pattern used by the previous row.
+	int prevObstaclesNr_;
+	/// Seed the segments of the current run are generated from.
+	unsigned runSeed_;
+	/// Time since the last automatic save.
+	float autosaveTimer_;
 
 	MainScene(Context* context);
 	~MainScene();
 
 	virtual void Start();
 
-private:
+protected:
 
-	SoundSource* musicSource_;
+	/// Node holding the persistent music voice.
+	SharedPtr<Node> musicNode_;
+	/// Music voice, reused for the whole session.
+	WeakPtr<SoundSource> musicSource_;
 	void PlayGame(StringHash eventType, VariantMap& eventData);
+	void ContinueGame(StringHash eventType, VariantMap& eventData);
+	/// Unpause the scene and bring back the in-game UI after a new run, a restart or a continue.
+	void ResumePlay();
 	void QuitGame(StringHash eventType, VariantMap& eventData);
+	/// Create the helpers the scene and the segment generation use.
+	void CreateSystems();
 	// Utworzenie sceny
 	void CreateScene();
+	/// Reset the run in the existing scene: clear all segments, rebuild the first one from the seed and reset the character.
+	void ResetRun(unsigned seed);
+	/// Return the node holding the content of a segment, create it if it does not exist.
+	Node* GetSegmentNode(int level);
+	/// Delete the segment the character has left behind and create the next one when it comes into view.
+	void StreamSegments();
+	/// Create floor, collectibles and obstacles of a segment.
+	void CreateSegment(ResourceCache* cache, int level);
+	/// Capture the gameplay state of the run.
+	void TakeSnapshot(RunSnapshot& snapshot);
+	/// Put the run back to a snapshot, rebuilding only the segments that differ. Return true if successful.
+	bool RestoreSnapshot(const RunSnapshot& snapshot);
+	/// Return bit mask of the carrots still present in a segment.
+	unsigned GetCarrotMask(int level);
+	/// Remove the carrots of a segment selected by a bit mask.
+	void RemoveCarrots(int level, unsigned mask);
 	void CreateCollectibles(ResourceCache* cache, int level);
 	void CreateFloor(ResourceCache* cache, int level);
 	void DeleteFloor(int level);
 	void CreateObstacles(ResourceCache* cache, int level);
+	/// Return the template a segment is built from.
+	SegmentTemplate* GetSegmentTemplate(int level) const;
 	// Utworzenie bohatera
 	void CreateCharacter();
 	void CreateUI();
@@ -53,12 +112,22 @@ private:
 
 	void CreateNewObstacles();
 
+	/// Apply the settings of the current quality level.
+	void ApplyQuality();
+	/// Derive the far clip and the tree draw distances from the fog range.
+	void UpdateViewDistance();
+	/// Return how far ahead of the character segments have to exist.
+	float GetStreamingHorizon() const;
+
 	void PlayMusic(ResourceCache* cache);
-	void PlaySound(ResourceCache* cache, int type);
+	void PauseMusic(bool pause);
+	void PlaySound(SoundEffect effect);
 
 	void Collect();
 	void UpdateScore();
 	void UpdateCollected();
+	/// Show the render statistics.
+	void UpdateStats();
 
 	void SubscribeToEvents();
 
@@ -70,8 +139,54 @@ private:
 	void GameOver();
 
 
+	/// Game log.
+	SharedPtr<GameLog> gameLog_;
+	/// Scope timings exported as traces.
+	SharedPtr<TraceProfiler> traceProfiler_;
+	/// Spawner of segment content.
+	SharedPtr<Spawner> spawner_;
+	/// Template of the first segment of a run.
+	SharedPtr<SegmentTemplate> startTemplate_;
+	/// Template of the following segments.
+	SharedPtr<SegmentTemplate> segmentTemplate_;
+	/// Quality level control.
+	SharedPtr<QualityGovernor> qualityGovernor_;
+	/// Per-category draw and shadow distances and the shadow caster cap.
+	SharedPtr<ShadowBudget> shadowBudget_;
+	/// Glow under the carrots.
+	SharedPtr<CollectibleGlow> collectibleGlow_;
+	/// Impostors of the distant trees.
+	SharedPtr<TreeImpostors> treeImpostors_;
+	/// Merges the static scenery of each segment.
+	SharedPtr<StaticBatcher> staticBatcher_;
+	/// Control key edges for the fixed step.
+	SharedPtr<InputQueue> inputQueue_;
+	/// Input latency instrumentation.
+	SharedPtr<LatencyTracer> latencyTracer_;
+	/// Third person camera collision.
+	SharedPtr<CameraCollision> cameraCollision_;
+	/// Occlusion culling readout.
+	SharedPtr<OcclusionStats> occlusionStats_;
+	/// Pooled voices for sound effects.
+	SharedPtr<SoundPool> soundPool_;
 	/// Touch utility object.
 	SharedPtr<Touch> touch_;
+	/// Parent node of all segments of the current run.
+	WeakPtr<Node> segmentsNode_;
+	/// Zone with the fog range.
+	WeakPtr<Zone> zone_;
+	/// Dust effect in front of the character.
+	WeakPtr<Node> efektNode_;
+	/// Camera component of the camera node.
+	ComponentRef<Camera> camera_;
+	/// Rigid body of the character.
+	ComponentRef<RigidBody> characterBody_;
+	/// Segments alive in the current run.
+	PODVector<SegmentDescriptor> segments_;
+	/// Last checkpoint of the run.
+	RunSnapshot checkpoint_;
+	/// Background writer for saves.
+	SharedPtr<SnapshotWriter> snapshotWriter_;
 	/// The controllable character component.
 	WeakPtr<Character> character_;
 };
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Engine/Application.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Physics/PhysicsEvents.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include <Bullet/BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h>
+
+#include "Character.h"
+#include "MicroBench.h"
+#include "Spawner.h"
+
+/// Allocations through the global operator new of the whole process. Includes the engine when it is linked statically;
+/// Bullet allocates through malloc and is not counted.
+static std::atomic<unsigned> numAllocations(0);
+
+void* operator new(std::size_t size)
+{
+	++numAllocations;
+	void* ptr = malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+URHO3D_DEFINE_APPLICATION_MAIN(MicroBench)
+
+MicroBench::MicroBench(Context* context) :
+	BenchApp(context),
+	startAllocations_(0)
+{
+}
+
+void MicroBench::RunBenches()
+{
+	BenchSegments();
+	BenchCollisions();
+}
+
+void MicroBench::BenchSegments()
+{
+	ResourceCache* cache = GetSubsystem<ResourceCache>();
+	ResetRun(BENCH_SEED);
+	// The start segment is built from its own template, only the regular segments are measured
+	DeleteFloor(0);
+
+	MicroBenchResult floor;
+	MicroBenchResult collectibles;
+	MicroBenchResult obstacles;
+	MicroBenchResult deletion;
+
+	for (int level = 1; level <= MICROBENCH_SEGMENTS; ++level)
+	{
+		// Same seed and order as CreateSegment, so the segments match those of a run
+		SetRandomSeed(runSeed_ + level * 7919);
+		Node* segment = GetSegmentNode(level);
+
+		unsigned numNodes = segment->GetNumChildren(true);
+		unsigned numBodies = GetNumBodies();
+		BeginMeasure();
+		CreateFloor(cache, level);
+		EndMeasure(floor);
+		floor.numNodes_ += segment->GetNumChildren(true) - numNodes;
+		floor.numBodies_ += GetNumBodies() - numBodies;
+
+		numNodes = segment->GetNumChildren(true);
+		numBodies = GetNumBodies();
+		BeginMeasure();
+		CreateCollectibles(cache, level);
+		EndMeasure(collectibles);
+		collectibles.numNodes_ += segment->GetNumChildren(true) - numNodes;
+		collectibles.numBodies_ += GetNumBodies() - numBodies;
+
+		numNodes = segment->GetNumChildren(true);
+		numBodies = GetNumBodies();
+		BeginMeasure();
+		CreateObstacles(cache, level);
+		EndMeasure(obstacles);
+		obstacles.numNodes_ += segment->GetNumChildren(true) - numNodes;
+		obstacles.numBodies_ += GetNumBodies() - numBodies;
+
+		// Two segments are alive at a time, as while running
+		Node* previous = segmentsNode_->GetChild("Segment" + String(level - 1));
+		if (previous)
+		{
+			numNodes = previous->GetNumChildren(true) + 1;
+			numBodies = GetNumBodies();
+			BeginMeasure();
+			DeleteFloor(level - 1);
+			EndMeasure(deletion);
+			deletion.numNodes_ += numNodes;
+			deletion.numBodies_ += numBodies - GetNumBodies();
+		}
+	}
+	DeleteFloor(MICROBENCH_SEGMENTS);
+
+	Report("CreateFloor", floor);
+	Report("CreateCollectibles", collectibles);
+	Report("CreateObstacles", obstacles);
+	Report("DeleteFloor", deletion);
+}
+
+void MicroBench::BenchCollisions()
+{
+	// The character subscribed to its collisions when it was created, no physics step is needed first
+	ResetRun(BENCH_SEED);
+
+	// The other bodies are spawned away from the path, nothing is simulated while the events are replayed
+	Node* benchNode = scene_->CreateChild("Bench");
+	RigidBody* floorBody = spawner_->Spawn(SPAWN_FLOOR, benchNode, Vector3(50.0f, 0.0f, 0.0f))->GetComponent<RigidBody>();
+	RigidBody* rockBody = spawner_->Spawn(SPAWN_ROCK, benchNode, Vector3(60.0f, 0.0f, 0.0f))->GetComponent<RigidBody>();
+	PODVector<RigidBody*> carrotBodies;
+	for (unsigned i = 0; i < MICROBENCH_PICKUPS; ++i)
+	{
+		Node* carrot = spawner_->Spawn(SPAWN_CARROT, benchNode, Vector3(70.0f, 1.0f, (float)i));
+		carrotBodies.Push(carrot->GetComponent<RigidBody>());
+	}
+
+	// Two contacts under the character with an upward normal, as when running on the floor
+	Vector3 position = character_->GetNode()->GetPosition();
+	VectorBuffer contacts;
+	for (unsigned i = 0; i < 2; ++i)
+	{
+		contacts.WriteVector3(position + Vector3(i ? 0.3f : -0.3f, 0.0f, 0.0f));
+		contacts.WriteVector3(Vector3::UP);
+		contacts.WriteFloat(0.0f);
+		contacts.WriteFloat(1.0f);
+	}
+
+	MicroBenchResult ground;
+	for (unsigned i = 0; i < MICROBENCH_CONTACTS; ++i)
+		SendCollision(floorBody, contacts.GetBuffer(), ground);
+	Report("HandleNodeCollision ground", ground);
+
+	MicroBenchResult obstacle;
+	for (unsigned i = 0; i < MICROBENCH_CONTACTS; ++i)
+	{
+		SendCollision(rockBody, contacts.GetBuffer(), obstacle);
+		character_->gameOver_ = false;
+	}
+	Report("HandleNodeCollision obstacle", obstacle);
+
+	MicroBenchResult pickup;
+	for (unsigned i = 0; i < carrotBodies.Size(); ++i)
+	{
+		unsigned numNodes = benchNode->GetNumChildren(true);
+		SendCollision(carrotBodies[i], contacts.GetBuffer(), pickup);
+		pickup.numNodes_ += numNodes - benchNode->GetNumChildren(true);
+	}
+	Report("HandleNodeCollision pickup", pickup);
+
+	benchNode->Remove();
+	character_->playCollectSound_ = false;
+	ResetRun(BENCH_SEED);
+}
+
+void MicroBench::SendCollision(RigidBody* otherBody, const PODVector<unsigned char>& contacts, MicroBenchResult& result)
+{
+	using namespace NodeCollision;
+
+	Node* characterNode = character_->GetNode();
+	VariantMap& eventData = characterNode->GetEventDataMap();
+	eventData[P_BODY] = characterBody_.Get(characterNode);
+	eventData[P_OTHERNODE] = otherBody->GetNode();
+	eventData[P_OTHERBODY] = otherBody;
+	eventData[P_TRIGGER] = otherBody->IsTrigger();
+	eventData[P_CONTACTS] = contacts;
+
+	unsigned numBodies = GetNumBodies();
+	BeginMeasure();
+	characterNode->SendEvent(E_NODECOLLISION, eventData);
+	EndMeasure(result);
+	result.numBodies_ += numBodies - GetNumBodies();
+}
+
+void MicroBench::BeginMeasure()
+{
+	startAllocations_ = numAllocations;
+	timer_.Reset();
+}
+
+void MicroBench::EndMeasure(MicroBenchResult& result)
+{
+	result.microseconds_ += timer_.GetUSec(false);
+	result.numAllocations_ += numAllocations - startAllocations_;
+	++result.numCalls_;
+}
+
+unsigned MicroBench::GetNumBodies() const
+{
+	return (unsigned)scene_->GetComponent<PhysicsWorld>()->GetWorld()->getNumCollisionObjects();
+}
+
+void MicroBench::Report(const char* name, const MicroBenchResult& result) const
+{
+	if (!result.numCalls_)
+		return;
+
+	float nanoseconds = result.microseconds_ * 1000.0f;
+	PrintLine(ToString("{\"bench\":\"%s\",\"calls\":%u,\"ns_per_call\":%f,\"ns_per_node\":%f,\"nodes_per_call\":%f,"
+		"\"bodies_per_call\":%f,\"allocations_per_call\":%f}", name, result.numCalls_, nanoseconds / result.numCalls_,
+		result.numNodes_ ? nanoseconds / result.numNodes_ : 0.0f, (float)result.numNodes_ / result.numCalls_,
+		(float)result.numBodies_ / result.numCalls_, (float)result.numAllocations_ / result.numCalls_));
+}
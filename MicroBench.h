@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Urho3D/Core/Timer.h>
+
+#include "BenchApp.h"
+
+/// Segments created and deleted by the segment benchmarks.
+const int MICROBENCH_SEGMENTS = 50;
+/// Ground and obstacle contacts replayed by the collision benchmark.
+const unsigned MICROBENCH_CONTACTS = 10000;
+/// Carrot pickups replayed by the collision benchmark, each removes its carrot.
+const unsigned MICROBENCH_PICKUPS = 1000;
+
+/// Totals of one measured operation.
+struct MicroBenchResult
+{
+	/// Construct zeroed.
+	MicroBenchResult() :
+		microseconds_(0),
+		numCalls_(0),
+		numNodes_(0),
+		numBodies_(0),
+		numAllocations_(0)
+	{
+	}
+
+	/// Time spent.
+	long long microseconds_;
+	/// Number of calls.
+	unsigned numCalls_;
+	/// Nodes created or removed.
+	unsigned numNodes_;
+	/// Bullet collision objects added or removed.
+	unsigned numBodies_;
+	/// Allocations made.
+	unsigned numAllocations_;
+};
+
+/// Headless micro-benchmarks of the segment generation and the collision handling.
+/// Times CreateFloor, CreateCollectibles, CreateObstacles and DeleteFloor one segment at a time, and replays synthetic
+/// collision events through the character's handler. Prints one JSON object per operation to stdout.
+class MicroBench : public BenchApp
+{
+	URHO3D_OBJECT(MicroBench, BenchApp);
+
+public:
+	/// Construct.
+	MicroBench(Context* context);
+
+protected:
+	/// Run the segment and collision benchmarks.
+	virtual void RunBenches();
+
+private:
+	/// Create and delete segments phase by phase.
+	void BenchSegments();
+	/// Replay collision events of every contact type.
+	void BenchCollisions();
+	/// Send a collision event with the other body to the character, counted into the result.
+	void SendCollision(RigidBody* otherBody, const PODVector<unsigned char>& contacts, MicroBenchResult& result);
+	/// Start measuring an operation.
+	void BeginMeasure();
+	/// Add the time and allocations since BeginMeasure to a result.
+	void EndMeasure(MicroBenchResult& result);
+	/// Return number of collision objects in the Bullet world.
+	unsigned GetNumBodies() const;
+	/// Print a result per node and per call.
+	void Report(const char* name, const MicroBenchResult& result) const;
+
+	/// Timer of the current measurement.
+	HiresTimer timer_;
+	/// Allocation count at the start of the current measurement.
+	unsigned startAllocations_;
+};
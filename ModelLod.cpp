@@ -0,0 +1,175 @@
+#include <Urho3D/Graphics/Geometry.h>
+#include <Urho3D/Graphics/IndexBuffer.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/VertexBuffer.h>
+#include <Urho3D/IO/Log.h>
+
+#include "ModelLod.h"
+
+ModelLod::ModelLod(Context* context) :
+	Object(context)
+{
+}
+
+ModelLod::~ModelLod()
+{
+}
+
+bool ModelLod::Generate(Model* model, const LodLevel* levels, unsigned numLevels)
+{
+	if (!model || !levels || !numLevels)
+		return false;
+
+	const BoundingBox& box = model->GetBoundingBox();
+	Vector<SharedPtr<IndexBuffer> > indexBuffers = model->GetIndexBuffers();
+	bool added = false;
+
+	for (unsigned i = 0; i < model->GetNumGeometries(); ++i)
+	{
+		// Keep the levels of models that were exported or baked with them
+		if (model->GetNumGeometryLodLevels(i) > 1)
+			continue;
+
+		Vector<SharedPtr<Geometry> > geometries;
+		geometries.Push(SharedPtr<Geometry>(model->GetGeometry(i, 0)));
+
+		for (unsigned j = 0; j < numLevels; ++j)
+		{
+			SharedPtr<Geometry> geometry = Decimate(geometries[0], box, levels[j].gridSize_, levels[j].distance_);
+			if (!geometry)
+				continue;
+			geometries.Push(geometry);
+			// Register the new index buffers with the model, so saving it stores the levels in the .mdl
+			indexBuffers.Push(SharedPtr<IndexBuffer>(geometry->GetIndexBuffer()));
+		}
+
+		if (geometries.Size() > 1)
+		{
+			model->SetNumGeometryLodLevels(i, geometries.Size());
+			for (unsigned j = 1; j < geometries.Size(); ++j)
+				model->SetGeometry(i, j, geometries[j]);
+			added = true;
+		}
+	}
+
+	if (added)
+	{
+		model->SetIndexBuffers(indexBuffers);
+
+		String budget;
+		for (unsigned i = 0; i <= numLevels; ++i)
+			budget += (i ? " / " : "") + String(GetNumTriangles(model, i));
+		URHO3D_LOGINFO("LOD triangles for " + model->GetName() + ": " + budget);
+	}
+
+	return added;
+}
+
+unsigned ModelLod::GetNumTriangles(Model* model, unsigned lodLevel)
+{
+	if (!model)
+		return 0;
+
+	unsigned triangles = 0;
+	for (unsigned i = 0; i < model->GetNumGeometries(); ++i)
+	{
+		unsigned numLevels = model->GetNumGeometryLodLevels(i);
+		if (!numLevels)
+			continue;
+		Geometry* geometry = model->GetGeometry(i, Min(lodLevel, numLevels - 1));
+		if (geometry && geometry->GetPrimitiveType() == TRIANGLE_LIST)
+			triangles += geometry->GetIndexCount() / 3;
+	}
+	return triangles;
+}
+
+SharedPtr<Geometry> ModelLod::Decimate(Geometry* source, const BoundingBox& box, unsigned gridSize, float distance)
+{
+	VertexBuffer* vertexBuffer = source ? source->GetVertexBuffer(0) : 0;
+	IndexBuffer* indexBuffer = source ? source->GetIndexBuffer() : 0;
+	if (!vertexBuffer || !indexBuffer || !vertexBuffer->GetShadowData() || !indexBuffer->GetShadowData() ||
+		source->GetPrimitiveType() != TRIANGLE_LIST || !gridSize)
+		return SharedPtr<Geometry>();
+
+	unsigned positionOffset = vertexBuffer->GetElementOffset(SEM_POSITION);
+	if (positionOffset == M_MAX_UNSIGNED)
+		return SharedPtr<Geometry>();
+
+	Vector3 size = box.Size();
+	float cellSize = Max(Max(size.x_, size.y_), size.z_) / gridSize;
+	if (cellSize <= 0.0f)
+		return SharedPtr<Geometry>();
+
+	const unsigned char* vertexData = vertexBuffer->GetShadowData();
+	unsigned vertexSize = vertexBuffer->GetVertexSize();
+	const unsigned char* indexData = indexBuffer->GetShadowData();
+	bool largeIndices = indexBuffer->GetIndexSize() == sizeof(unsigned);
+	unsigned indexStart = source->GetIndexStart();
+	unsigned indexCount = source->GetIndexCount();
+
+	// Representative vertex of each vertex and of each occupied cell
+	PODVector<unsigned> remap(vertexBuffer->GetVertexCount());
+	for (unsigned i = 0; i < remap.Size(); ++i)
+		remap[i] = M_MAX_UNSIGNED;
+	HashMap<unsigned, unsigned> cells;
+
+	PODVector<unsigned> indices;
+	indices.Reserve(indexCount);
+
+	for (unsigned i = indexStart; i + 2 < indexStart + indexCount; i += 3)
+	{
+		unsigned triangle[3];
+		for (unsigned j = 0; j < 3; ++j)
+		{
+			unsigned index = largeIndices ? ((const unsigned*)indexData)[i + j] : ((const unsigned short*)indexData)[i + j];
+			if (remap[index] == M_MAX_UNSIGNED)
+			{
+				const Vector3& position = *reinterpret_cast<const Vector3*>(vertexData + index * vertexSize + positionOffset);
+				Vector3 cell = (position - box.min_) / cellSize;
+				unsigned key = ((unsigned)cell.x_ & 0x3ff) | ((unsigned)cell.y_ & 0x3ff) << 10 | ((unsigned)cell.z_ & 0x3ff) << 20;
+				HashMap<unsigned, unsigned>::ConstIterator k = cells.Find(key);
+				if (k == cells.End())
+				{
+					cells[key] = index;
+					remap[index] = index;
+				}
+				else
+					remap[index] = k->second_;
+			}
+			triangle[j] = remap[index];
+		}
+
+		// Triangles with two corners in the same cell have collapsed
+		if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2])
+			continue;
+
+		indices.Push(triangle[0]);
+		indices.Push(triangle[1]);
+		indices.Push(triangle[2]);
+	}
+
+	// Not worth a level if the reduction is small, or nothing is left to draw
+	if (indices.Empty() || indices.Size() * 10 > indexCount * 9)
+		return SharedPtr<Geometry>();
+
+	SharedPtr<IndexBuffer> newIndexBuffer(new IndexBuffer(context_));
+	newIndexBuffer->SetShadowed(true);
+	newIndexBuffer->SetSize(indices.Size(), largeIndices);
+	if (largeIndices)
+		newIndexBuffer->SetData(&indices[0]);
+	else
+	{
+		PODVector<unsigned short> shortIndices(indices.Size());
+		for (unsigned i = 0; i < indices.Size(); ++i)
+			shortIndices[i] = (unsigned short)indices[i];
+		newIndexBuffer->SetData(&shortIndices[0]);
+	}
+
+	SharedPtr<Geometry> geometry(new Geometry(context_));
+	geometry->SetNumVertexBuffers(1);
+	geometry->SetVertexBuffer(0, vertexBuffer);
+	geometry->SetIndexBuffer(newIndexBuffer);
+	geometry->SetDrawRange(TRIANGLE_LIST, 0, indices.Size(), source->GetVertexStart(), source->GetVertexCount());
+	geometry->SetLodDistance(distance);
+	return geometry;
+}
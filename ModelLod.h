@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+
+namespace Urho3D
+{
+	class BoundingBox;
+	class Geometry;
+	class Model;
+}
+
+using namespace Urho3D;
+
+/// Description of a generated LOD level.
+struct LodLevel
+{
+	/// Distance at which the level is used.
+	float distance_;
+	/// Number of clustering cells along the longest side of the model's bounding box. Lower is coarser.
+	unsigned gridSize_;
+};
+
+/// Generates LOD levels for models that ship without them.
+/// Vertices are clustered on a grid and every vertex is welded onto the first vertex of its cell, which drops the
+/// triangles that collapse. The levels only get new index buffers, the shadowed vertex buffer of the model is shared.
+class ModelLod : public Object
+{
+	URHO3D_OBJECT(ModelLod, Object);
+
+public:
+	/// Construct.
+	ModelLod(Context* context);
+	/// Destruct.
+	~ModelLod();
+
+	/// Add levels to each geometry of the model that has no LOD levels yet. Return true if any were added.
+	bool Generate(Model* model, const LodLevel* levels, unsigned numLevels);
+
+	/// Return number of triangles drawn for a model at a LOD level.
+	static unsigned GetNumTriangles(Model* model, unsigned lodLevel);
+
+private:
+	/// Create a reduced copy of a geometry. Return null if the geometry can not be reduced.
+	SharedPtr<Geometry> Decimate(Geometry* source, const BoundingBox& box, unsigned gridSize, float distance);
+};
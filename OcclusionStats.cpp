@@ -0,0 +1,59 @@
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Drawable.h>
+#include <Urho3D/Graphics/GraphicsEvents.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/OctreeQuery.h>
+#include <Urho3D/Graphics/Renderer.h>
+#include <Urho3D/Graphics/View.h>
+#include <Urho3D/Graphics/Viewport.h>
+
+#include "OcclusionStats.h"
+
+OcclusionStats::OcclusionStats(Context* context) :
+	Object(context),
+	numOccluders_(0),
+	numCulled_(0),
+	numCulledBatches_(0)
+{
+	SubscribeToEvent(E_ENDRENDERING, URHO3D_HANDLER(OcclusionStats, HandleEndRendering));
+}
+
+OcclusionStats::~OcclusionStats()
+{
+}
+
+void OcclusionStats::HandleEndRendering(StringHash eventType, VariantMap& eventData)
+{
+	numOccluders_ = 0;
+	numCulled_ = 0;
+	numCulledBatches_ = 0;
+
+	Viewport* viewport = GetSubsystem<Renderer>()->GetViewport(0);
+	View* view = viewport ? viewport->GetView() : 0;
+	Camera* camera = view ? view->GetCamera() : 0;
+	Octree* octree = view ? view->GetOctree() : 0;
+	if (!camera || !octree)
+		return;
+
+	numOccluders_ = view->GetOccluders().Size();
+	if (!numOccluders_)
+		return;
+
+	// Drawables past their draw distance are left out by the view as well, they do not count as occluded. The distance
+	// is measured to the bounding box center like the view does
+	PODVector<Drawable*> drawables;
+	FrustumOctreeQuery query(drawables, camera->GetFrustum(), DRAWABLE_GEOMETRY, camera->GetViewMask());
+	octree->GetDrawables(query);
+	for (unsigned i = 0; i < drawables.Size(); ++i)
+	{
+		Drawable* drawable = drawables[i];
+		if (drawable->IsInView())
+			continue;
+		float drawDistance = drawable->GetDrawDistance();
+		if (drawDistance > 0.0f && camera->GetDistance(drawable->GetWorldBoundingBox().Center()) > drawDistance)
+			continue;
+
+		++numCulled_;
+		numCulledBatches_ += drawable->GetBatches().Size();
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+
+using namespace Urho3D;
+
+/// Maximum number of occluder triangles rendered per frame. Only the floor occludes, the baked floor of a segment is ten
+/// boxes of 12 triangles and two segments are alive at a time.
+const int MAX_OCCLUDER_TRIANGLES = 2000;
+
+/// Counts what occlusion culling removed from the main view.
+/// After every frame, the geometries inside the camera frustum and within their draw distance that the view did not
+/// mark visible are the ones hidden by occluders.
+class OcclusionStats : public Object
+{
+	URHO3D_OBJECT(OcclusionStats, Object);
+
+public:
+	/// Construct.
+	OcclusionStats(Context* context);
+	/// Destruct.
+	~OcclusionStats();
+
+	/// Return number of occluders rendered last frame.
+	unsigned GetNumOccluders() const { return numOccluders_; }
+	/// Return number of drawables culled by occlusion last frame.
+	unsigned GetNumCulled() const { return numCulled_; }
+	/// Return number of batches culled by occlusion last frame.
+	unsigned GetNumCulledBatches() const { return numCulledBatches_; }
+
+private:
+	/// Count the culled drawables of the frame.
+	void HandleEndRendering(StringHash eventType, VariantMap& eventData);
+
+	/// Occluders last frame.
+	unsigned numOccluders_;
+	/// Culled drawables last frame.
+	unsigned numCulled_;
+	/// Culled batches last frame.
+	unsigned numCulledBatches_;
+};
@@ -0,0 +1,91 @@
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/IO/Log.h>
+
+#include "QualityGovernor.h"
+
+/// Quality levels from lowest to highest. The occluders are large floor boxes, so a coarse occlusion buffer still
+/// culls most of what they hide.
+static const QualityLevel qualityLevels[NUM_QUALITY_LEVELS] =
+{
+	{ 512, 1, false, false, 60.0f, 0.5f, 128 },
+	{ 1024, 2, false, true, 80.0f, 0.75f, 128 },
+	{ 1024, 3, false, true, 100.0f, 1.0f, 256 },
+	{ 2048, 3, true, true, 100.0f, 1.0f, 256 }
+};
+
+/// Number of frames in a measurement window.
+static const unsigned WINDOW_FRAMES = 90;
+/// The level goes down when the percentile is over the target by this factor.
+static const float SLOW_FACTOR = 1.15f;
+/// The level goes up when the percentile is under the target by this factor.
+static const float FAST_FACTOR = 0.75f;
+/// Number of fast windows in a row needed to go up.
+static const unsigned FAST_WINDOWS_TO_STEP_UP = 4;
+
+QualityGovernor::QualityGovernor(Context* context) :
+	Object(context),
+	targetFrameTime_(TARGET_FRAME_TIME),
+	percentile_(0.0f),
+	level_(NUM_QUALITY_LEVELS - 1),
+	fastWindows_(0),
+	skipWindow_(false)
+{
+	samples_.Reserve(WINDOW_FRAMES);
+}
+
+QualityGovernor::~QualityGovernor()
+{
+}
+
+bool QualityGovernor::Update(float frameTime)
+{
+	samples_.Push(frameTime);
+	if (samples_.Size() < WINDOW_FRAMES)
+		return false;
+
+	if (skipWindow_)
+	{
+		skipWindow_ = false;
+		samples_.Clear();
+		return false;
+	}
+
+	Sort(samples_.Begin(), samples_.End());
+	percentile_ = samples_[samples_.Size() * 95 / 100];
+	samples_.Clear();
+
+	unsigned level = level_;
+	if (percentile_ > targetFrameTime_ * SLOW_FACTOR)
+	{
+		fastWindows_ = 0;
+		if (level_ > 0)
+			--level;
+	}
+	else if (percentile_ < targetFrameTime_ * FAST_FACTOR)
+	{
+		if (++fastWindows_ >= FAST_WINDOWS_TO_STEP_UP && level_ < NUM_QUALITY_LEVELS - 1)
+			++level;
+	}
+	else
+		fastWindows_ = 0;
+
+	if (level == level_)
+		return false;
+
+	URHO3D_LOGINFOF("Quality level %u -> %u, 95th percentile frame time %f ms", level_, level, percentile_ * 1000.0f);
+	SetLevel(level);
+	return true;
+}
+
+void QualityGovernor::SetLevel(unsigned level)
+{
+	level_ = Min(level, NUM_QUALITY_LEVELS - 1);
+	fastWindows_ = 0;
+	skipWindow_ = true;
+	samples_.Clear();
+}
+
+const QualityLevel& QualityGovernor::GetSettings() const
+{
+	return qualityLevels[level_];
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+
+using namespace Urho3D;
+
+/// Settings of one quality level.
+struct QualityLevel
+{
+	/// Shadow map size.
+	int shadowMapSize_;
+	/// Number of shadow cascades.
+	unsigned numCascades_;
+	/// Bloom post-process.
+	bool bloom_;
+	/// FXAA post-process.
+	bool fxaa_;
+	/// Fog end, the far clip follows it.
+	float viewDistance_;
+	/// Fraction of the decoration placements that is spawned.
+	float decorationDensity_;
+	/// Width of the occlusion buffer in pixels.
+	int occlusionBufferSize_;
+};
+
+/// Number of quality levels.
+const unsigned NUM_QUALITY_LEVELS = 4;
+/// Frame time the governor aims for.
+const float TARGET_FRAME_TIME = 1.0f / 60.0f;
+
+/// Steps the quality level by measured frame times.
+/// Frame times are collected over a window of frames. When the 95th percentile of a window is clearly over the target,
+/// the level goes down a step; only after several windows in a row clearly under the target does it go up again. After
+/// a change the next window is skipped, so the frames of the switch itself are not counted.
+class QualityGovernor : public Object
+{
+	URHO3D_OBJECT(QualityGovernor, Object);
+
+public:
+	/// Construct. Starts at the highest level.
+	QualityGovernor(Context* context);
+	/// Destruct.
+	~QualityGovernor();
+
+	/// Add the time of a frame. Return true if the level changed.
+	bool Update(float frameTime);
+	/// Set the level.
+	void SetLevel(unsigned level);
+	/// Set the frame time to aim for.
+	void SetTargetFrameTime(float frameTime) { targetFrameTime_ = frameTime; }
+
+	/// Return the current level index.
+	unsigned GetLevel() const { return level_; }
+	/// Return the settings of the current level.
+	const QualityLevel& GetSettings() const;
+	/// Return the 95th percentile frame time of the last window.
+	float GetFrameTimePercentile() const { return percentile_; }
+
+private:
+	/// Frame times of the current window.
+	PODVector<float> samples_;
+	/// Frame time to aim for.
+	float targetFrameTime_;
+	/// 95th percentile of the last window.
+	float percentile_;
+	/// Current level.
+	unsigned level_;
+	/// Number of windows in a row with room to spare.
+	unsigned fastWindows_;
+	/// Skip the current window.
+	bool skipWindow_;
+};
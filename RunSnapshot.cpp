@@ -0,0 +1,105 @@
+#include <Urho3D/IO/Deserializer.h>
+#include <Urho3D/IO/Serializer.h>
+
+#include "RunSnapshot.h"
+
+/// Snapshot format version, bump when the layout changes.
+static const unsigned SNAPSHOT_VERSION = 1;
+
+RunSnapshot::RunSnapshot() :
+	valid_(false),
+	runSeed_(0),
+	randomSeed_(0),
+	time_(0.0f),
+	level_(0),
+	currentLevel_(0),
+	numBoxes_(0),
+	prevObstaclesNr_(0)
+{
+	character_.position_ = Vector3::ZERO;
+	character_.rotation_ = Quaternion::IDENTITY;
+	character_.linearVelocity_ = Vector3::ZERO;
+	character_.speed_ = 1.0f;
+	character_.collected_ = 0;
+	character_.onGround_ = false;
+	character_.okToJump_ = true;
+	character_.inAirTimer_ = 0.0f;
+}
+
+bool RunSnapshot::Save(Serializer& dest) const
+{
+	if (!valid_)
+		return false;
+
+	bool success = true;
+	success &= dest.WriteFileID("RSNP");
+	success &= dest.WriteUInt(SNAPSHOT_VERSION);
+	success &= dest.WriteUInt(runSeed_);
+	success &= dest.WriteUInt(randomSeed_);
+	success &= dest.WriteFloat(time_);
+	success &= dest.WriteInt(level_);
+	success &= dest.WriteInt(currentLevel_);
+	success &= dest.WriteInt(numBoxes_);
+	success &= dest.WriteInt(prevObstaclesNr_);
+
+	success &= dest.WriteVector3(character_.position_);
+	success &= dest.WritePackedQuaternion(character_.rotation_);
+	success &= dest.WriteVector3(character_.linearVelocity_);
+	success &= dest.WriteFloat(character_.speed_);
+	success &= dest.WriteInt(character_.collected_);
+	success &= dest.WriteBool(character_.onGround_);
+	success &= dest.WriteBool(character_.okToJump_);
+	success &= dest.WriteFloat(character_.inAirTimer_);
+
+	success &= dest.WriteVLE(segments_.Size());
+	for (unsigned i = 0; i < segments_.Size(); ++i)
+	{
+		const SegmentDescriptor& segment = segments_[i];
+		success &= dest.WriteInt(segment.level_);
+		success &= dest.WriteUByte((unsigned char)segment.numBoxes_);
+		success &= dest.WriteUByte((unsigned char)segment.prevObstaclesNr_);
+		success &= dest.WriteUInt(segment.carrots_);
+	}
+
+	return success;
+}
+
+bool RunSnapshot::Load(Deserializer& source)
+{
+	valid_ = false;
+	segments_.Clear();
+
+	if (source.ReadFileID() != "RSNP" || source.ReadUInt() != SNAPSHOT_VERSION)
+		return false;
+
+	runSeed_ = source.ReadUInt();
+	randomSeed_ = source.ReadUInt();
+	time_ = source.ReadFloat();
+	level_ = source.ReadInt();
+	currentLevel_ = source.ReadInt();
+	numBoxes_ = source.ReadInt();
+	prevObstaclesNr_ = source.ReadInt();
+
+	character_.position_ = source.ReadVector3();
+	character_.rotation_ = source.ReadPackedQuaternion();
+	character_.linearVelocity_ = source.ReadVector3();
+	character_.speed_ = source.ReadFloat();
+	character_.collected_ = source.ReadInt();
+	character_.onGround_ = source.ReadBool();
+	character_.okToJump_ = source.ReadBool();
+	character_.inAirTimer_ = source.ReadFloat();
+
+	unsigned numSegments = source.ReadVLE();
+	segments_.Resize(numSegments);
+	for (unsigned i = 0; i < numSegments; ++i)
+	{
+		SegmentDescriptor& segment = segments_[i];
+		segment.level_ = source.ReadInt();
+		segment.numBoxes_ = source.ReadUByte();
+		segment.prevObstaclesNr_ = source.ReadUByte();
+		segment.carrots_ = source.ReadUInt();
+	}
+
+	valid_ = true;
+	return true;
+}
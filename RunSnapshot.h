@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Urho3D/Container/Vector.h>
+#include <Urho3D/Math/Quaternion.h>
+
+namespace Urho3D
+{
+	class Deserializer;
+	class Serializer;
+}
+
+using namespace Urho3D;
+
+/// Segment that is alive in the run. Holds the generator state the segment was built from, so it can be rebuilt exactly.
+struct SegmentDescriptor
+{
+	/// Segment index.
+	int level_;
+	/// Obstacle row count before the segment was built.
+	int numBoxes_;
+	/// Obstacle pattern of the previous row before the segment was built.
+	int prevObstaclesNr_;
+	/// Bit mask of the carrots still present in the segment.
+	unsigned carrots_;
+};
+
+/// Dynamic state of the character.
+struct CharacterState
+{
+	/// World position.
+	Vector3 position_;
+	/// World rotation.
+	Quaternion rotation_;
+	/// Linear velocity of the rigid body.
+	Vector3 linearVelocity_;
+	/// Multiplier of the movement force, 1 at the start of a run and raised by 0.1 per segment passed.
+	float speed_;
+	/// Carrots collected in the run.
+	int collected_;
+	/// Ground contact in the last physics step.
+	bool onGround_;
+	/// Jump control released since the last jump.
+	bool okToJump_;
+	/// Time off the ground in seconds, 0 while grounded.
+	float inAirTimer_;
+};
+
+/// Compact snapshot of the gameplay state of a run: everything needed to put the run back without touching the static
+/// world. Used for checkpoints, continuing after game over and replays.
+class RunSnapshot
+{
+public:
+	/// Construct an empty snapshot.
+	RunSnapshot();
+
+	/// Write to a binary stream. Return true if successful.
+	bool Save(Serializer& dest) const;
+	/// Read from a binary stream. Return true if successful.
+	bool Load(Deserializer& source);
+
+	/// Return whether the snapshot holds a run.
+	bool IsValid() const { return valid_; }
+	/// Mark the snapshot empty.
+	void Clear() { valid_ = false; segments_.Clear(); }
+
+	/// Valid flag.
+	bool valid_;
+	/// Seed the segments of the run are generated from.
+	unsigned runSeed_;
+	/// Global random generator state.
+	unsigned randomSeed_;
+	/// Score timer.
+	float time_;
+	/// Highest segment built.
+	int level_;
+	/// Segment the character is in.
+	int currentLevel_;
+	/// Obstacle row count for the next segment.
+	int numBoxes_;
+	/// Obstacle pattern of the last row built.
+	int prevObstaclesNr_;
+	/// Character state.
+	CharacterState character_;
+	/// Segments alive at the time of the snapshot.
+	PODVector<SegmentDescriptor> segments_;
+};
@@ -0,0 +1,244 @@
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Engine/Application.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Drawable.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Math/MathDefs.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "Character.h"
+#include "RunnerBench.h"
+#include "SegmentTemplate.h"
+#include "Spawner.h"
+
+URHO3D_DEFINE_APPLICATION_MAIN(RunnerBench)
+
+/// Add the obstacles and carrots of a segment with their positions to a hash.
+static unsigned HashLayout(Node* segment, unsigned hash)
+{
+	static const StringHash obstacleName("Obstacle");
+	static const StringHash carrotName("Carrot");
+
+	const Vector<SharedPtr<Node> >& children = segment->GetChildren();
+	for (unsigned i = 0; i < children.Size(); ++i)
+	{
+		StringHash name = children[i]->GetNameHash();
+		if (name != obstacleName && name != carrotName)
+			continue;
+
+		const Vector3& position = children[i]->GetPosition();
+		int values[] = { (int)name.Value(), (int)Round(position.x_ * 100.0f), (int)Round(position.y_ * 100.0f),
+			(int)Round(position.z_ * 100.0f) };
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+		for (unsigned j = 0; j < sizeof values; ++j)
+			hash = SDBMHash(hash, bytes[j]);
+	}
+
+	return hash;
+}
+
+RunnerBench::RunnerBench(Context* context) :
+	BenchApp(context)
+{
+}
+
+void RunnerBench::RunBenches()
+{
+	// Obstacles only report their collisions instead of stopping the character, so every run covers its full distance
+	const SpawnType obstacles[] = { SPAWN_ROCK, SPAWN_DEAD_TREE };
+	for (unsigned i = 0; i < sizeof obstacles / sizeof obstacles[0]; ++i)
+	{
+		RigidBody* body = spawner_->GetPrototype(obstacles[i])->GetComponent<RigidBody>();
+		if (body)
+			body->SetTrigger(true);
+	}
+
+	CheckDeterminism();
+	BenchGeneration();
+	BenchObstacleDensity();
+	BenchRun(1.0f, BENCH_SEGMENTS);
+	BenchRun(2.0f, BENCH_SEGMENTS);
+	BenchRun(3.0f, BENCH_SEGMENTS);
+	BenchRestarts();
+}
+
+void RunnerBench::CheckDeterminism()
+{
+	// Restoring a snapshot rebuilds segments from their seed, possibly at another quality level than they were first
+	// built at, and the carrot masks of the snapshot index the carrots of the rebuilt rows
+	const float densities[] = { 1.0f, 0.75f, 0.5f, 0.25f, 0.0f };
+	const unsigned numDensities = sizeof densities / sizeof densities[0];
+	ResourceCache* cache = GetSubsystem<ResourceCache>();
+	unsigned reference = 0;
+	bool identical = true;
+
+	for (unsigned i = 0; i < numDensities; ++i)
+	{
+		startTemplate_->SetDecorationDensity(densities[i]);
+		segmentTemplate_->SetDecorationDensity(densities[i]);
+		ResetRun(BENCH_SEED);
+
+		unsigned hash = HashLayout(GetSegmentNode(0), 0);
+		for (int level = 1; level <= BENCH_SEGMENTS; ++level)
+		{
+			CreateSegment(cache, level);
+			level_ = level;
+			hash = HashLayout(GetSegmentNode(level), hash);
+			DeleteFloor(level - 1);
+		}
+
+		if (!i)
+			reference = hash;
+		else if (hash != reference)
+			identical = false;
+	}
+
+	// Back to the densities of the quality level
+	ApplyQuality();
+
+	PrintLine(ToString("{\"scenario\":\"determinism\",\"densities\":%u,\"segments\":%d,\"identical\":%s}", numDensities,
+		BENCH_SEGMENTS, identical ? "true" : "false"));
+	if (!identical)
+		exitCode_ = 1;
+}
+
+void RunnerBench::BenchGeneration()
+{
+	ResourceCache* cache = GetSubsystem<ResourceCache>();
+	ResetRun(BENCH_SEED);
+
+	float total = 0.0f;
+	float minTime = M_INFINITY;
+	float maxTime = 0.0f;
+	unsigned numBodies = 0;
+	HiresTimer timer;
+
+	// Two segments are alive at a time, as while running
+	for (int level = 1; level <= BENCH_SEGMENTS; ++level)
+	{
+		timer.Reset();
+		CreateSegment(cache, level);
+		float time = timer.GetUSec(false) / 1000.0f;
+		level_ = level;
+
+		total += time;
+		minTime = Min(minTime, time);
+		maxTime = Max(maxTime, time);
+		numBodies += CountBodies(GetSegmentNode(level));
+
+		DeleteFloor(level - 1);
+	}
+
+	PrintLine(ToString("{\"scenario\":\"generation\",\"segments\":%d,\"mean_ms\":%f,\"min_ms\":%f,\"max_ms\":%f,"
+		"\"bodies_per_segment\":%f}", BENCH_SEGMENTS, total / BENCH_SEGMENTS, minTime, maxTime,
+		(float)numBodies / BENCH_SEGMENTS));
+}
+
+void RunnerBench::BenchObstacleDensity()
+{
+	ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+	for (unsigned rows = segmentTemplate_->GetMinObstacleRows(); rows <= segmentTemplate_->GetObstacleRows(); ++rows)
+	{
+		ResetRun(BENCH_SEED);
+
+		float total = 0.0f;
+		unsigned numBodies = 0;
+		HiresTimer timer;
+
+		// Every fifth level keeps the row count it is given, the others would thin it out
+		for (int i = 1; i <= BENCH_SEGMENTS; ++i)
+		{
+			int level = i * 5;
+			numBoxes_ = rows;
+			timer.Reset();
+			CreateSegment(cache, level);
+			total += timer.GetUSec(false) / 1000.0f;
+			numBodies += CountBodies(GetSegmentNode(level));
+			DeleteFloor(level);
+		}
+
+		PrintLine(ToString("{\"scenario\":\"density\",\"rows\":%u,\"segments\":%d,\"mean_ms\":%f,\"bodies_per_segment\":%f}",
+			rows, BENCH_SEGMENTS, total / BENCH_SEGMENTS, (float)numBodies / BENCH_SEGMENTS));
+	}
+}
+
+void RunnerBench::BenchRun(float speed, int numSegments)
+{
+	ResetRun(BENCH_SEED);
+
+	PhysicsWorld* physicsWorld = scene_->GetComponent<PhysicsWorld>();
+	Octree* octree = scene_->GetComponent<Octree>();
+	Node* characterNode = character_->GetNode();
+	float startZ = characterNode->GetPosition().z_;
+
+	// The octree is normally updated by the renderer, do it here so moved and removed drawables do not pile up
+	FrameInfo frame;
+	frame.camera_ = camera_.Get(cameraNode_);
+	frame.timeStep_ = BENCH_TIME_STEP;
+	frame.viewSize_ = IntVector2(1280, 720);
+
+	long long physicsTime = 0;
+	long long streamingTime = 0;
+	unsigned numFrames = 0;
+	HiresTimer totalTimer;
+	HiresTimer timer;
+
+	while (currentLevel_ < numSegments && numFrames < BENCH_MAX_FRAMES)
+	{
+		character_->speed_ = speed;
+		character_->gameOver_ = false;
+
+		timer.Reset();
+		physicsWorld->Update(BENCH_TIME_STEP);
+		physicsTime += timer.GetUSec(true);
+		StreamSegments();
+		streamingTime += timer.GetUSec(true);
+
+		frame.frameNumber_ = ++numFrames;
+		octree->Update(frame);
+	}
+
+	float total = totalTimer.GetUSec(false) / 1000000.0f;
+	float meters = characterNode->GetPosition().z_ - startZ;
+
+	PrintLine(ToString("{\"scenario\":\"run\",\"speed\":%f,\"segments\":%d,\"completed\":%s,\"frames\":%u,"
+		"\"physics_ms_per_frame\":%f,\"streaming_ms_per_frame\":%f,\"total_s\":%f,\"meters_per_second\":%f}", speed,
+		currentLevel_, currentLevel_ >= numSegments ? "true" : "false", numFrames,
+		numFrames ? physicsTime / 1000.0f / numFrames : 0.0f, numFrames ? streamingTime / 1000.0f / numFrames : 0.0f,
+		total, total > 0.0f ? meters / total : 0.0f));
+}
+
+void RunnerBench::BenchRestarts()
+{
+	float total = 0.0f;
+	float maxTime = 0.0f;
+	HiresTimer timer;
+
+	for (unsigned i = 0; i < BENCH_RESTARTS; ++i)
+	{
+		timer.Reset();
+		ResetRun(BENCH_SEED + i);
+		float time = timer.GetUSec(false) / 1000.0f;
+		total += time;
+		maxTime = Max(maxTime, time);
+	}
+
+	PrintLine(ToString("{\"scenario\":\"restart\",\"restarts\":%u,\"mean_ms\":%f,\"max_ms\":%f}", BENCH_RESTARTS,
+		total / BENCH_RESTARTS, maxTime));
+}
+
+unsigned RunnerBench::CountBodies(Node* node) const
+{
+	if (!node)
+		return 0;
+
+	PODVector<RigidBody*> bodies;
+	node->GetComponents<RigidBody>(bodies, true);
+	return bodies.Size();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "BenchApp.h"
+
+/// Frames after which a run scenario gives up, ten simulated minutes.
+const unsigned BENCH_MAX_FRAMES = 36000;
+/// Segments built per generation scenario.
+const int BENCH_SEGMENTS = 20;
+/// Resets of the restart scenario.
+const unsigned BENCH_RESTARTS = 20;
+
+/// Headless benchmark of the game code.
+/// Runs fixed-seed scenarios without window, audio or input and prints one JSON object per scenario to stdout, so the
+/// numbers of different builds can be compared directly.
+class RunnerBench : public BenchApp
+{
+	URHO3D_OBJECT(RunnerBench, BenchApp);
+
+public:
+	/// Construct.
+	RunnerBench(Context* context);
+
+protected:
+	/// Run all scenarios.
+	virtual void RunBenches();
+
+private:
+	/// Check that a seed gives the same obstacles and carrots at every decoration density.
+	void CheckDeterminism();
+	/// Build segments the way a run does and time each one.
+	void BenchGeneration();
+	/// Build segments at every obstacle row count of the template.
+	void BenchObstacleDensity();
+	/// Run the character through a number of segments at a fixed speed, stepping physics and streaming every frame.
+	void BenchRun(float speed, int numSegments);
+	/// Reset the run repeatedly.
+	void BenchRestarts();
+	/// Return number of rigid bodies below a node.
+	unsigned CountBodies(Node* node) const;
+};
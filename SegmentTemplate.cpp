@@ -0,0 +1,345 @@
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Resource/XMLFile.h>
+#include <Urho3D/Scene/Node.h>
+
+#include "GameLog.h"
+#include "SegmentTemplate.h"
+
+SegmentTemplate::SegmentTemplate(Context* context, Spawner* spawner) :
+	Object(context),
+	spawner_(spawner),
+	length_(100.0f),
+	lodBias_(1.0f),
+	decorationDensity_(1.0f)
+{
+	memset(&obstacles_, 0, sizeof obstacles_);
+	memset(&collectibles_, 0, sizeof collectibles_);
+}
+
+SegmentTemplate::~SegmentTemplate()
+{
+}
+
+bool SegmentTemplate::Load(XMLFile* file, unsigned depth)
+{
+	if (!file)
+	{
+		URHO3D_LOGERROR("Null segment template file");
+		return false;
+	}
+
+	XMLElement root = file->GetRoot("segment");
+	if (!root)
+	{
+		URHO3D_LOGERROR("Segment template " + file->GetName() + " has no segment element");
+		return false;
+	}
+
+	scenery_.Clear();
+	placements_.Clear();
+	patterns_.Clear();
+	memset(&obstacles_, 0, sizeof obstacles_);
+	memset(&collectibles_, 0, sizeof collectibles_);
+
+	// Start from the base template, then add to and override it
+	if (root.HasAttribute("base"))
+	{
+		// A template that is its own base, directly or through others, would recurse until the stack overflows
+		if (depth >= MAX_TEMPLATE_DEPTH)
+		{
+			URHO3D_LOGERROR("Segment template " + file->GetName() + " has base templates nested deeper than " +
+				String(MAX_TEMPLATE_DEPTH) + ", the chain of bases is probably a cycle");
+			return false;
+		}
+
+		SegmentTemplate base(context_, spawner_);
+		if (!base.Load(GetSubsystem<ResourceCache>()->GetResource<XMLFile>(root.GetAttribute("base")), depth + 1))
+			return false;
+
+		length_ = base.length_;
+		lodBias_ = base.lodBias_;
+		scenery_ = base.scenery_;
+		if (!root.GetChild("obstacles"))
+			CopySection(base, base.obstacles_, obstacles_);
+		if (!root.GetChild("collectibles"))
+			CopySection(base, base.collectibles_, collectibles_);
+	}
+
+	if (root.HasAttribute("length"))
+		length_ = root.GetFloat("length");
+	if (root.HasAttribute("lodbias"))
+		lodBias_ = root.GetFloat("lodbias");
+
+	for (XMLElement place = root.GetChild("scenery").GetChild("place"); place; place = place.GetNext("place"))
+	{
+		PlacementRecord record;
+		if (!LoadPlacement(place, record))
+			return false;
+		scenery_.Push(record);
+	}
+
+	XMLElement obstacles = root.GetChild("obstacles");
+	if (obstacles && !LoadSection(obstacles, obstacles_))
+		return false;
+	XMLElement collectibles = root.GetChild("collectibles");
+	if (collectibles && !LoadSection(collectibles, collectibles_))
+		return false;
+
+	URHO3D_LOGINFOF("Compiled segment template %s: %u placements, %u patterns", file->GetName().CString(),
+		GetNumPlacements(), patterns_.Size());
+	return true;
+}
+
+bool SegmentTemplate::LoadPlacement(const XMLElement& element, PlacementRecord& record)
+{
+	const String& typeName = element.GetAttribute("type");
+	SpawnType type = Spawner::GetTypeByName(typeName);
+	if (type == MAX_SPAWN_TYPES)
+	{
+		URHO3D_LOGERROR("Unknown spawn type " + typeName + " in segment template");
+		return false;
+	}
+
+	record.type_ = (unsigned char)type;
+	record.altType_ = record.type_;
+	record.altChance_ = 0.0f;
+	if (element.HasAttribute("alt"))
+	{
+		SpawnType altType = Spawner::GetTypeByName(element.GetAttribute("alt"));
+		if (altType == MAX_SPAWN_TYPES)
+		{
+			URHO3D_LOGERROR("Unknown spawn type " + element.GetAttribute("alt") + " in segment template");
+			return false;
+		}
+		record.altType_ = (unsigned char)altType;
+		record.altChance_ = element.HasAttribute("altchance") ? element.GetFloat("altchance") : 0.5f;
+	}
+
+	record.position_ = element.HasAttribute("position") ? element.GetVector3("position") : Vector3::ZERO;
+	record.step_ = element.HasAttribute("step") ? element.GetVector3("step") : Vector3::ZERO;
+	record.jitter_ = element.HasAttribute("jitter") ? element.GetVector3("jitter") : Vector3::ZERO;
+	if (element.HasAttribute("rotation"))
+	{
+		Vector3 euler = element.GetVector3("rotation");
+		record.rotation_ = Quaternion(euler.x_, euler.y_, euler.z_);
+	}
+	else
+		record.rotation_ = Quaternion::IDENTITY;
+
+	Vector2 scale = element.HasAttribute("scale") ? element.GetVector2("scale") : Vector2::ONE;
+	record.minScale_ = scale.x_;
+	record.maxScale_ = Max(scale.x_, scale.y_);
+	record.lodBias_ = element.HasAttribute("lodbias") ? element.GetFloat("lodbias") : lodBias_;
+	record.decoration_ = element.GetBool("decoration");
+	record.count_ = (unsigned short)(element.HasAttribute("count") ? Max(element.GetUInt("count"), 1U) : 1U);
+
+	String lane = element.GetAttribute("lane").ToLower();
+	if (lane.Empty() || lane == "fixed")
+		record.lane_ = LANE_FIXED;
+	else if (lane == "random")
+		record.lane_ = LANE_RANDOM;
+	else if (lane == "distinct")
+		record.lane_ = LANE_DISTINCT;
+	else if (lane == "same")
+		record.lane_ = LANE_SAME;
+	else
+	{
+		URHO3D_LOGERROR("Unknown lane rule " + lane + " in segment template");
+		return false;
+	}
+
+	return true;
+}
+
+bool SegmentTemplate::LoadSection(const XMLElement& element, RowSection& section)
+{
+	section.rows_ = element.GetUInt("rows");
+	section.minRows_ = element.HasAttribute("minrows") ? Min(element.GetUInt("minrows"), section.rows_) : section.rows_;
+	section.start_ = element.HasAttribute("start") ? element.GetFloat("start") : 0.0f;
+	section.span_ = element.HasAttribute("span") ? element.GetFloat("span") : length_;
+	section.firstPattern_ = patterns_.Size();
+	section.numPatterns_ = 0;
+	section.totalWeight_ = 0.0f;
+
+	for (XMLElement patternElem = element.GetChild("pattern"); patternElem; patternElem = patternElem.GetNext("pattern"))
+	{
+		PatternRecord pattern;
+		pattern.first_ = placements_.Size();
+		pattern.count_ = 0;
+		pattern.weight_ = patternElem.HasAttribute("weight") ? patternElem.GetFloat("weight") : 1.0f;
+		pattern.noRepeat_ = patternElem.GetBool("norepeat");
+
+		for (XMLElement place = patternElem.GetChild("place"); place; place = place.GetNext("place"))
+		{
+			PlacementRecord record;
+			if (!LoadPlacement(place, record))
+				return false;
+			placements_.Push(record);
+			++pattern.count_;
+		}
+
+		patterns_.Push(pattern);
+		++section.numPatterns_;
+		section.totalWeight_ += pattern.weight_;
+	}
+
+	if (section.rows_ && !section.numPatterns_)
+	{
+		URHO3D_LOGERROR("Segment template section " + element.GetName() + " has rows but no patterns");
+		return false;
+	}
+
+	return true;
+}
+
+void SegmentTemplate::CopySection(const SegmentTemplate& source, const RowSection& sourceSection, RowSection& section)
+{
+	section = sourceSection;
+	section.firstPattern_ = patterns_.Size();
+
+	for (unsigned i = 0; i < sourceSection.numPatterns_; ++i)
+	{
+		PatternRecord pattern = source.patterns_[sourceSection.firstPattern_ + i];
+		unsigned first = pattern.first_;
+		pattern.first_ = placements_.Size();
+		for (unsigned j = 0; j < pattern.count_; ++j)
+			placements_.Push(source.placements_[first + j]);
+		patterns_.Push(pattern);
+	}
+}
+
+void SegmentTemplate::CreateScenery(Node* segment, float z) const
+{
+	Vector3 origin(0.0f, 0.0f, z);
+	int lane = 0;
+	unsigned usedLanes = 0;
+
+	for (unsigned i = 0; i < scenery_.Size(); ++i)
+	{
+		const PlacementRecord& record = scenery_[i];
+		for (unsigned j = 0; j < record.count_; ++j)
+		{
+			// A decoration always draws its thinning number and goes through Place also when it is left out, so the
+			// density does not change the numbers the obstacles and carrots draw from the segment seed
+			bool spawn = !record.decoration_ || Random(1.0f) < decorationDensity_;
+			Place(record, segment, origin + record.step_ * (float)j, lane, usedLanes, spawn);
+		}
+	}
+}
+
+int SegmentTemplate::CreateObstacles(Node* segment, float z, unsigned rows, int prevPattern) const
+{
+	return CreateRows(obstacles_, segment, z, rows, prevPattern);
+}
+
+void SegmentTemplate::CreateCollectibles(Node* segment, float z) const
+{
+	CreateRows(collectibles_, segment, z, collectibles_.rows_, -1);
+}
+
+int SegmentTemplate::CreateRows(const RowSection& section, Node* segment, float z, unsigned rows, int prevPattern) const
+{
+	if (!section.numPatterns_)
+		return prevPattern;
+
+	for (unsigned i = 0; i < rows; ++i)
+	{
+		unsigned patternIndex = PickPattern(section, prevPattern);
+		prevPattern = patternIndex;
+
+		const PatternRecord& pattern = patterns_[section.firstPattern_ + patternIndex];
+		Vector3 origin(0.0f, 0.0f, z + section.start_ + int(i * section.span_ / rows));
+		GAME_LOG(LOGCAT_GENERATION, LOG_DEBUG, "Row at z %.0f: pattern %u of %u", origin.z_, patternIndex, section.numPatterns_);
+		int lane = 0;
+		unsigned usedLanes = 0;
+
+		for (unsigned j = 0; j < pattern.count_; ++j)
+		{
+			const PlacementRecord& record = placements_[pattern.first_ + j];
+			Node* node = Place(record, segment, origin, lane, usedLanes);
+			if (node && record.type_ == SPAWN_CARROT)
+				node->SetVar(VAR_CARROT_INDEX, (int)i);
+		}
+	}
+
+	return prevPattern;
+}
+
+unsigned SegmentTemplate::PickPattern(const RowSection& section, int prevPattern) const
+{
+	unsigned index = 0;
+
+	// Patterns marked no-repeat get one re-roll when they come up twice in a row, which makes them rarer back to back
+	// without forbidding it
+	for (unsigned attempt = 0; attempt < 2; ++attempt)
+	{
+		float pick = Random(section.totalWeight_);
+		for (index = 0; index < section.numPatterns_ - 1; ++index)
+		{
+			pick -= patterns_[section.firstPattern_ + index].weight_;
+			if (pick < 0.0f)
+				break;
+		}
+
+		if ((int)index != prevPattern || !patterns_[section.firstPattern_ + index].noRepeat_)
+			break;
+	}
+
+	return index;
+}
+
+Node* SegmentTemplate::Place(const PlacementRecord& record, Node* segment, const Vector3& origin, int& lane,
+	unsigned& usedLanes, bool spawn) const
+{
+	SpawnType type = (SpawnType)record.type_;
+	if (record.altChance_ > 0.0f && Random(1.0f) < record.altChance_)
+		type = (SpawnType)record.altType_;
+
+	Vector3 position = origin + record.position_;
+
+	switch (record.lane_)
+	{
+	case LANE_RANDOM:
+		lane = Random(NUM_LANES);
+		break;
+
+	case LANE_DISTINCT:
+		// A lane not taken by an earlier placement of the row, as long as there is one left
+		do
+			lane = Random(NUM_LANES);
+		while ((usedLanes & (1 << lane)) && usedLanes != (1 << NUM_LANES) - 1);
+		break;
+
+	default:
+		break;
+	}
+
+	if (record.lane_ != LANE_FIXED)
+	{
+		position.x_ += (lane - 1) * LANE_WIDTH;
+		usedLanes |= 1 << lane;
+	}
+
+	if (record.jitter_ != Vector3::ZERO)
+		position += Vector3(Random(record.jitter_.x_), Random(record.jitter_.y_), Random(record.jitter_.z_));
+
+	float scale = record.maxScale_ > record.minScale_ ? Random(record.minScale_, record.maxScale_) : record.minScale_;
+	if (!spawn)
+		return 0;
+
+	Node* node = spawner_->Spawn(type, segment, position, record.rotation_, scale);
+
+	if (node && record.lodBias_ != 1.0f)
+	{
+		const Vector<SharedPtr<Component> >& components = node->GetComponents();
+		for (unsigned i = 0; i < components.Size(); ++i)
+		{
+			if (components[i]->GetType() == StaticModel::GetTypeStatic())
+				static_cast<StaticModel*>(components[i].Get())->SetLodBias(record.lodBias_);
+		}
+	}
+
+	return node;
+}
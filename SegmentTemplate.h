@@ -0,0 +1,167 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Math/Quaternion.h>
+
+#include "Spawner.h"
+
+namespace Urho3D
+{
+	class Node;
+	class XMLElement;
+	class XMLFile;
+}
+
+using namespace Urho3D;
+
+/// Node variable with the index of a carrot within its segment, used to record which carrots were collected.
+const StringHash VAR_CARROT_INDEX("CarrotIndex");
+/// Distance between the lanes.
+const float LANE_WIDTH = 2.5f;
+/// Longest chain of base templates. A longer one is taken to be a cycle.
+const unsigned MAX_TEMPLATE_DEPTH = 8;
+/// Number of lanes.
+const int NUM_LANES = 3;
+
+/// How a placement picks its lane.
+enum LaneRule
+{
+	LANE_FIXED = 0,
+	LANE_RANDOM,
+	LANE_DISTINCT,
+	LANE_SAME
+};
+
+/// Compiled placement. Plain data, instantiated straight from the table.
+struct PlacementRecord
+{
+	/// Position relative to the segment start, or to the row for obstacles and collectibles.
+	Vector3 position_;
+	/// Offset between repeats.
+	Vector3 step_;
+	/// Random offset range added to the position.
+	Vector3 jitter_;
+	/// Rotation.
+	Quaternion rotation_;
+	/// Minimum scale.
+	float minScale_;
+	/// Maximum scale.
+	float maxScale_;
+	/// Chance to spawn the alternative type instead.
+	float altChance_;
+	/// LOD bias of the spawned models, 1 keeps the prototype's.
+	float lodBias_;
+	/// Number of repeats.
+	unsigned short count_;
+	/// Spawn type.
+	unsigned char type_;
+	/// Alternative spawn type.
+	unsigned char altType_;
+	/// Lane rule.
+	unsigned char lane_;
+	/// Decoration that is thinned out by the decoration density.
+	bool decoration_;
+};
+
+/// Weighted group of placements spawned together on one row.
+struct PatternRecord
+{
+	/// Index of the first placement.
+	unsigned first_;
+	/// Number of placements.
+	unsigned count_;
+	/// Selection weight.
+	float weight_;
+	/// Pick again once if the previous row used the same pattern.
+	bool noRepeat_;
+};
+
+/// Rows of obstacles or collectibles spread along the segment.
+struct RowSection
+{
+	/// Number of rows.
+	unsigned rows_;
+	/// Minimum number of rows.
+	unsigned minRows_;
+	/// Distance of the first row from the segment start.
+	float start_;
+	/// Distance covered by the rows.
+	float span_;
+	/// Index of the first pattern.
+	unsigned firstPattern_;
+	/// Number of patterns.
+	unsigned numPatterns_;
+	/// Sum of the pattern weights.
+	float totalWeight_;
+};
+
+/// Segment layout loaded from XML and compiled into flat placement tables.
+/// A template may name a base template: its scenery is added to the base scenery, and the obstacle and collectible
+/// sections it defines replace those of the base.
+class SegmentTemplate : public Object
+{
+	URHO3D_OBJECT(SegmentTemplate, Object);
+
+public:
+	/// Construct.
+	SegmentTemplate(Context* context, Spawner* spawner);
+	/// Destruct.
+	~SegmentTemplate();
+
+	/// Compile from an XML file. Return true if successful. Depth is the number of templates based on this one.
+	bool Load(XMLFile* file, unsigned depth = 0);
+
+	/// Spawn the scenery of a segment starting at z.
+	void CreateScenery(Node* segment, float z) const;
+	/// Spawn the given number of obstacle rows. Return the pattern used on the last row.
+	int CreateObstacles(Node* segment, float z, unsigned rows, int prevPattern) const;
+	/// Spawn the collectible rows.
+	void CreateCollectibles(Node* segment, float z) const;
+
+	/// Set the fraction of decoration placements that is spawned.
+	void SetDecorationDensity(float density) { decorationDensity_ = Clamp(density, 0.0f, 1.0f); }
+
+	/// Return segment length.
+	float GetLength() const { return length_; }
+	/// Return initial number of obstacle rows.
+	unsigned GetObstacleRows() const { return obstacles_.rows_; }
+	/// Return minimum number of obstacle rows.
+	unsigned GetMinObstacleRows() const { return obstacles_.minRows_; }
+	/// Return number of compiled placements.
+	unsigned GetNumPlacements() const { return scenery_.Size() + placements_.Size(); }
+
+private:
+	/// Compile a placement element.
+	bool LoadPlacement(const XMLElement& element, PlacementRecord& record);
+	/// Compile an obstacle or collectible section.
+	bool LoadSection(const XMLElement& element, RowSection& section);
+	/// Copy a section and its patterns from another template.
+	void CopySection(const SegmentTemplate& source, const RowSection& sourceSection, RowSection& section);
+	/// Spawn the rows of a section. Return the pattern used on the last row.
+	int CreateRows(const RowSection& section, Node* segment, float z, unsigned rows, int prevPattern) const;
+	/// Pick a pattern of a section.
+	unsigned PickPattern(const RowSection& section, int prevPattern) const;
+	/// Spawn one placement. The lane and used lane mask are shared by the placements of a row. Without spawn only the
+	/// random numbers of the placement are drawn.
+	Node* Place(const PlacementRecord& record, Node* segment, const Vector3& origin, int& lane, unsigned& usedLanes,
+		bool spawn = true) const;
+
+	/// Spawner.
+	SharedPtr<Spawner> spawner_;
+	/// Segment length.
+	float length_;
+	/// Default LOD bias of the segment's placements.
+	float lodBias_;
+	/// Fraction of decoration placements spawned.
+	float decorationDensity_;
+	/// Scenery placements.
+	PODVector<PlacementRecord> scenery_;
+	/// Obstacle and collectible placements, referenced by the patterns.
+	PODVector<PlacementRecord> placements_;
+	/// Obstacle and collectible patterns.
+	PODVector<PatternRecord> patterns_;
+	/// Obstacle rows.
+	RowSection obstacles_;
+	/// Collectible rows.
+	RowSection collectibles_;
+};
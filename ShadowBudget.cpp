@@ -0,0 +1,215 @@
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Graphics/Batch.h>
+#include <Urho3D/Graphics/Drawable.h>
+#include <Urho3D/Graphics/GraphicsEvents.h>
+#include <Urho3D/Graphics/Light.h>
+#include <Urho3D/Graphics/Renderer.h>
+#include <Urho3D/Graphics/View.h>
+#include <Urho3D/Graphics/Viewport.h>
+#include <Urho3D/Scene/Node.h>
+
+#include "ShadowBudget.h"
+
+/// Draw and shadow distance of a category, 0 is unlimited, and its part in occlusion culling.
+struct CategorySettings
+{
+	float drawDistance_;
+	float shadowDistance_;
+	bool occluder_;
+	bool occludee_;
+};
+
+/// Settings per category. Trees past 50 m are impostors anyway, a carrot's shadow is not visible past 20 m. The floor
+/// hides what is below the path and is always in front of the camera, so it is not worth an occlusion test itself. The
+/// walls are alpha blended and write no depth, so they hide nothing and are only tested.
+static const CategorySettings categorySettings[] =
+{
+	{ 0.0f, 0.0f, true, false },    // CATEGORY_FLOOR
+	{ 0.0f, 0.0f, false, true },    // CATEGORY_GRASS
+	{ 0.0f, 0.0f, false, true },    // CATEGORY_WALL
+	{ 0.0f, 60.0f, false, true },   // CATEGORY_TREE
+	{ 0.0f, 40.0f, false, true },   // CATEGORY_ROCK
+	{ 0.0f, 50.0f, false, true },   // CATEGORY_DEAD_TREE
+	{ 80.0f, 20.0f, false, true },  // CATEGORY_COLLECTIBLE
+	{ 60.0f, 0.0f, false, true },   // CATEGORY_EFFECT
+	{ 0.0f, 0.0f, false, true }     // CATEGORY_CHARACTER
+};
+
+/// Default shadow batch cap of a cascade.
+static const unsigned DEFAULT_CASTER_CAP = 48;
+/// Factor a cascade over its cap is pulled in by per frame.
+static const float SPLIT_SHRINK = 0.95f;
+/// Factor a cascade with room is let out by per frame.
+static const float SPLIT_GROW = 1.02f;
+/// Fraction of the cap a cascade has to be under before it grows again.
+static const float SPLIT_GROW_THRESHOLD = 0.75f;
+
+ShadowBudget::ShadowBudget(Context* context) :
+	Object(context),
+	numSplits_(0),
+	maxNumSplits_(0)
+{
+	for (unsigned i = 0; i < MAX_SHADOW_SPLITS; ++i)
+	{
+		maxSplits_[i] = 0.0f;
+		splits_[i] = 0.0f;
+		casterCaps_[i] = DEFAULT_CASTER_CAP;
+		shadowBatches_[i] = 0;
+	}
+
+	SubscribeToEvent(E_ENDRENDERING, URHO3D_HANDLER(ShadowBudget, HandleEndRendering));
+}
+
+ShadowBudget::~ShadowBudget()
+{
+}
+
+void ShadowBudget::Apply(Spawner* spawner)
+{
+	for (unsigned i = 0; i < MAX_SPAWN_TYPES; ++i)
+	{
+		Node* prototype = spawner->GetPrototype((SpawnType)i);
+		if (prototype)
+			Apply(prototype, GetCategory((SpawnType)i));
+	}
+}
+
+void ShadowBudget::Apply(Node* node, SceneryCategory category)
+{
+	if (!node)
+		return;
+
+	const CategorySettings& settings = categorySettings[category];
+	PODVector<Drawable*> drawables;
+	node->GetDerivedComponents<Drawable>(drawables, true);
+	for (unsigned i = 0; i < drawables.Size(); ++i)
+	{
+		drawables[i]->SetDrawDistance(settings.drawDistance_);
+		drawables[i]->SetShadowDistance(settings.shadowDistance_);
+		drawables[i]->SetOccluder(settings.occluder_);
+		drawables[i]->SetOccludee(settings.occludee_);
+	}
+}
+
+void ShadowBudget::SetLight(Light* light)
+{
+	light_ = light;
+	numSplits_ = 0;
+	maxNumSplits_ = 0;
+	if (!light)
+		return;
+
+	const float* cascadeSplits = light->GetShadowCascade().splits_.Data();
+	for (unsigned i = 0; i < MAX_SHADOW_SPLITS; ++i)
+	{
+		maxSplits_[i] = cascadeSplits[i];
+		splits_[i] = cascadeSplits[i];
+		if (cascadeSplits[i] > 0.0f)
+			numSplits_ = i + 1;
+	}
+	maxNumSplits_ = numSplits_;
+}
+
+void ShadowBudget::SetNumSplits(unsigned num)
+{
+	num = Clamp(num, 1U, maxNumSplits_);
+	if (!light_ || num == numSplits_)
+		return;
+
+	// The last cascade in use reaches as far as the last configured one, so shadows keep their range with fewer splits
+	for (unsigned i = 0; i < MAX_SHADOW_SPLITS; ++i)
+		splits_[i] = i < num ? maxSplits_[i] : 0.0f;
+	splits_[num - 1] = maxSplits_[maxNumSplits_ - 1];
+	numSplits_ = num;
+	ApplySplits();
+}
+
+void ShadowBudget::SetCasterCap(unsigned split, unsigned cap)
+{
+	if (split < MAX_SHADOW_SPLITS)
+		casterCaps_[split] = cap;
+}
+
+SceneryCategory ShadowBudget::GetCategory(SpawnType type)
+{
+	switch (type)
+	{
+	case SPAWN_ROCK:
+		return CATEGORY_ROCK;
+	case SPAWN_DEAD_TREE:
+		return CATEGORY_DEAD_TREE;
+	case SPAWN_CARROT:
+		return CATEGORY_COLLECTIBLE;
+	case SPAWN_GRASS:
+		return CATEGORY_GRASS;
+	case SPAWN_WALL:
+		return CATEGORY_WALL;
+	case SPAWN_TREE2:
+	case SPAWN_TREE3:
+		return CATEGORY_TREE;
+	default:
+		return CATEGORY_FLOOR;
+	}
+}
+
+void ShadowBudget::HandleEndRendering(StringHash eventType, VariantMap& eventData)
+{
+	for (unsigned i = 0; i < MAX_SHADOW_SPLITS; ++i)
+		shadowBatches_[i] = 0;
+
+	Light* light = light_;
+	Viewport* viewport = GetSubsystem<Renderer>()->GetViewport(0);
+	View* view = viewport ? viewport->GetView() : 0;
+	if (!light || !view || !numSplits_)
+		return;
+
+	// Count the draw calls of each shadow split of the light, instanced groups count once
+	const Vector<LightBatchQueue>& lightQueues = view->GetLightQueues();
+	for (unsigned i = 0; i < lightQueues.Size(); ++i)
+	{
+		const LightBatchQueue& queue = lightQueues[i];
+		if (queue.light_ != light)
+			continue;
+
+		for (unsigned j = 0; j < queue.shadowSplits_.Size() && j < MAX_SHADOW_SPLITS; ++j)
+		{
+			const BatchQueue& batches = queue.shadowSplits_[j].shadowBatches_;
+			shadowBatches_[j] = batches.batches_.Size() + batches.batchGroups_.Size();
+		}
+	}
+
+	// The splits stay increasing: a split shrinks no closer than the one before it and grows no farther than the one after
+	// it, otherwise the light gets broken cascades
+	bool changed = false;
+	for (unsigned i = 0; i < numSplits_; ++i)
+	{
+		float nearLimit = i ? splits_[i - 1] + 1.0f : 1.0f;
+		float farLimit = i == numSplits_ - 1 ? maxSplits_[maxNumSplits_ - 1] : Min(maxSplits_[i], splits_[i + 1] - 1.0f);
+		float split = splits_[i];
+
+		if (shadowBatches_[i] > casterCaps_[i])
+			split = Max(split * SPLIT_SHRINK, nearLimit);
+		else if (shadowBatches_[i] < casterCaps_[i] * SPLIT_GROW_THRESHOLD && split < farLimit)
+			split = Min(split * SPLIT_GROW, farLimit);
+
+		if (split != splits_[i])
+		{
+			splits_[i] = split;
+			changed = true;
+		}
+	}
+
+	if (changed)
+		ApplySplits();
+}
+
+void ShadowBudget::ApplySplits()
+{
+	Light* light = light_;
+	if (!light)
+		return;
+
+	const CascadeParameters& cascade = light->GetShadowCascade();
+	light->SetShadowCascade(CascadeParameters(splits_[0], splits_[1], splits_[2], splits_[3], cascade.fadeStart_,
+		cascade.biasAutoAdjust_));
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+
+#include "Spawner.h"
+
+namespace Urho3D
+{
+	class Light;
+	class Node;
+}
+
+using namespace Urho3D;
+
+/// Object categories with their own draw and shadow distances and occlusion settings.
+enum SceneryCategory
+{
+	CATEGORY_FLOOR = 0,
+	CATEGORY_GRASS,
+	CATEGORY_WALL,
+	CATEGORY_TREE,
+	CATEGORY_ROCK,
+	CATEGORY_DEAD_TREE,
+	CATEGORY_COLLECTIBLE,
+	CATEGORY_EFFECT,
+	CATEGORY_CHARACTER,
+	MAX_SCENERY_CATEGORIES
+};
+
+/// Maximum number of shadow cascades tracked.
+const unsigned MAX_SHADOW_SPLITS = 4;
+
+/// Shadow budget.
+/// Draw and shadow distances and the occluder and occludee flags are assigned per category to the spawner prototypes,
+/// so every spawned copy inherits them.
+/// The shadow batches rendered in each cascade of the main light are counted after every frame; a cascade over its
+/// caster cap has its far split pulled in until it fits, and is let out again towards the configured split once there
+/// is room.
+class ShadowBudget : public Object
+{
+	URHO3D_OBJECT(ShadowBudget, Object);
+
+public:
+	/// Construct.
+	ShadowBudget(Context* context);
+	/// Destruct.
+	~ShadowBudget();
+
+	/// Apply the category settings to the spawner prototypes. Has to be called before spawning.
+	void Apply(Spawner* spawner);
+	/// Apply the category settings to the drawables of a node and its children.
+	void Apply(Node* node, SceneryCategory category);
+	/// Set the light whose cascades are budgeted. Its current cascade splits are the configured maximum.
+	void SetLight(Light* light);
+	/// Limit the number of cascades used, up to the number the light was configured with.
+	void SetNumSplits(unsigned num);
+	/// Set the shadow caster cap of a cascade, measured in shadow batches.
+	void SetCasterCap(unsigned split, unsigned cap);
+
+	/// Return category of a spawn type.
+	static SceneryCategory GetCategory(SpawnType type);
+	/// Return number of cascades of the light.
+	unsigned GetNumSplits() const { return numSplits_; }
+	/// Return number of shadow batches rendered in a cascade last frame.
+	unsigned GetNumShadowBatches(unsigned split) const { return split < MAX_SHADOW_SPLITS ? shadowBatches_[split] : 0; }
+	/// Return current far distance of a cascade.
+	float GetSplit(unsigned split) const { return split < MAX_SHADOW_SPLITS ? splits_[split] : 0.0f; }
+
+private:
+	/// Count the shadow batches of the frame and adjust the cascades.
+	void HandleEndRendering(StringHash eventType, VariantMap& eventData);
+	/// Set the current splits to the light.
+	void ApplySplits();
+
+	/// Budgeted light.
+	WeakPtr<Light> light_;
+	/// Number of cascades in use.
+	unsigned numSplits_;
+	/// Number of cascades the light was configured with.
+	unsigned maxNumSplits_;
+	/// Configured cascade splits.
+	float maxSplits_[MAX_SHADOW_SPLITS];
+	/// Current cascade splits.
+	float splits_[MAX_SHADOW_SPLITS];
+	/// Shadow batch cap per cascade.
+	unsigned casterCaps_[MAX_SHADOW_SPLITS];
+	/// Shadow batches per cascade last frame.
+	unsigned shadowBatches_[MAX_SHADOW_SPLITS];
+};
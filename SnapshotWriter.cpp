@@ -0,0 +1,93 @@
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+#include "RunSnapshot.h"
+#include "SnapshotWriter.h"
+
+SnapshotWriter::SnapshotWriter(Context* context, const String& fileName) :
+	Object(context),
+	fileName_(fileName),
+	hasPending_(false),
+	numWritten_(0)
+{
+	Run();
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		shouldRun_ = false;
+	}
+	condition_.notify_one();
+	Stop();
+}
+
+bool SnapshotWriter::Queue(const RunSnapshot& snapshot)
+{
+	// Serialize on the calling thread so the writer works from its own copy, the snapshot is only a few hundred bytes
+	VectorBuffer buffer;
+	if (!snapshot.Save(buffer))
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		pending_.Resize(buffer.GetSize());
+		if (buffer.GetSize())
+			memcpy(&pending_[0], buffer.GetData(), buffer.GetSize());
+		hasPending_ = true;
+	}
+
+	condition_.notify_one();
+	return true;
+}
+
+void SnapshotWriter::ThreadFunction()
+{
+	for (;;)
+	{
+		{
+			// The pending save and the stop request are checked under the lock, so neither is missed when it is signaled
+			// before the thread waits. The queue is drained also when stopping, so the last requested save is not lost
+			// on exit
+			std::unique_lock<std::mutex> lock(mutex_);
+			condition_.wait(lock, [this] { return hasPending_ || !shouldRun_; });
+			if (!hasPending_)
+				break;
+			writing_.Swap(pending_);
+			hasPending_ = false;
+		}
+
+		Write(writing_);
+	}
+}
+
+void SnapshotWriter::Write(const PODVector<unsigned char>& data)
+{
+	if (data.Empty())
+		return;
+
+	// Write to a temporary file first, so a crash during the write never leaves a truncated save behind
+	String tempName = fileName_ + ".tmp";
+	{
+		File file(context_, tempName, FILE_WRITE);
+		if (!file.IsOpen() || file.Write(&data[0], data.Size()) != data.Size())
+		{
+			URHO3D_LOGERROR("Could not write save " + tempName);
+			return;
+		}
+	}
+
+	FileSystem* fileSystem = GetSubsystem<FileSystem>();
+	if (fileSystem->FileExists(fileName_))
+		fileSystem->Delete(fileName_);
+	if (!fileSystem->Rename(tempName, fileName_))
+	{
+		URHO3D_LOGERROR("Could not replace save " + fileName_);
+		return;
+	}
+
+	++numWritten_;
+}
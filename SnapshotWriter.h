@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Thread.h>
+
+using namespace Urho3D;
+
+class RunSnapshot;
+
+/// Interval of the automatic save while playing, in seconds.
+const float AUTOSAVE_INTERVAL = 30.0f;
+
+/// Writes run snapshots to disk on a background thread.
+/// The main thread only serializes the snapshot into a small binary buffer; opening and writing the file happens on the
+/// writer thread. If several saves are queued before the thread gets to them, only the newest one is written.
+class SnapshotWriter : public Object, public Thread
+{
+	URHO3D_OBJECT(SnapshotWriter, Object);
+
+public:
+	/// Construct with the destination file name and start the writer thread.
+	SnapshotWriter(Context* context, const String& fileName);
+	/// Stop the writer thread after finishing the pending save.
+	~SnapshotWriter();
+
+	/// Queue a snapshot to be written. Return false if the snapshot is empty.
+	bool Queue(const RunSnapshot& snapshot);
+	/// Return number of saves written so far.
+	unsigned GetNumWritten() const { return numWritten_; }
+
+	/// Writer thread loop.
+	virtual void ThreadFunction();
+
+private:
+	/// Write one buffer to the destination file.
+	void Write(const PODVector<unsigned char>& data);
+
+	/// Destination file name.
+	String fileName_;
+	/// Serialized snapshot waiting to be written.
+	PODVector<unsigned char> pending_;
+	/// Buffer owned by the writer thread.
+	PODVector<unsigned char> writing_;
+	/// Pending flag.
+	bool hasPending_;
+	/// Mutex guarding the pending buffer and the stop request.
+	std::mutex mutex_;
+	/// Wakes up the writer thread. Unlike Urho3D's Condition it waits on a predicate, so a wakeup sent before the thread
+	/// starts waiting is not lost.
+	std::condition_variable condition_;
+	/// Number of saves written.
+	volatile unsigned numWritten_;
+};
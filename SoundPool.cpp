@@ -0,0 +1,134 @@
+#include <Urho3D/Audio/Audio.h>
+#include <Urho3D/Audio/Sound.h>
+#include <Urho3D/Audio/SoundSource.h>
+#include <Urho3D/Scene/Node.h>
+
+#include "GameLog.h"
+#include "SoundPool.h"
+
+SoundPool::SoundPool(Context* context) :
+	Object(context),
+	stamp_(0),
+	numStolen_(0)
+{
+	for (unsigned i = 0; i < MAX_SOUND_EFFECTS; ++i)
+	{
+		effects_[i].maxConcurrent_ = NUM_SOUND_VOICES;
+		effects_[i].gain_ = 1.0f;
+	}
+}
+
+SoundPool::~SoundPool()
+{
+}
+
+void SoundPool::CreateVoices(Node* node, unsigned numVoices)
+{
+	// Release the old voices, they may belong to a scene that is being destroyed
+	for (unsigned i = 0; i < voices_.Size(); ++i)
+	{
+		if (voices_[i].source_)
+			voices_[i].source_->Remove();
+	}
+	voices_.Clear();
+
+	if (!node)
+		return;
+
+	voices_.Resize(numVoices);
+	for (unsigned i = 0; i < numVoices; ++i)
+	{
+		// Voices are created once and reused, so they must not remove themselves when the sound ends
+		SoundSource* source = node->CreateComponent<SoundSource>(LOCAL);
+		source->SetSoundType(SOUND_EFFECT);
+		source->SetAutoRemoveMode(REMOVE_DISABLED);
+		voices_[i].source_ = source;
+		voices_[i].effect_ = -1;
+		voices_[i].stamp_ = 0;
+	}
+}
+
+void SoundPool::SetEffect(SoundEffect effect, Sound* sound, unsigned maxConcurrent, float gain)
+{
+	Effect& def = effects_[effect];
+	def.sound_ = sound;
+	def.maxConcurrent_ = Max(maxConcurrent, 1U);
+	def.gain_ = gain;
+}
+
+bool SoundPool::Play(SoundEffect effect)
+{
+	const Effect& def = effects_[effect];
+	if (!def.sound_ || voices_.Empty())
+		return false;
+
+	Voice* freeVoice = 0;
+	Voice* oldestVoice = 0;
+	Voice* oldestSameVoice = 0;
+	unsigned numSame = 0;
+
+	for (unsigned i = 0; i < voices_.Size(); ++i)
+	{
+		Voice& voice = voices_[i];
+		if (!voice.source_)
+			continue;
+
+		if (!voice.source_->IsPlaying())
+		{
+			if (!freeVoice)
+				freeVoice = &voice;
+			continue;
+		}
+
+		if (!oldestVoice || voice.stamp_ < oldestVoice->stamp_)
+			oldestVoice = &voice;
+		if (voice.effect_ == effect)
+		{
+			++numSame;
+			if (!oldestSameVoice || voice.stamp_ < oldestSameVoice->stamp_)
+				oldestSameVoice = &voice;
+		}
+	}
+
+	// Respect the concurrency limit first by restarting the oldest voice of the same effect, then use a free voice,
+	// and only steal an unrelated voice when the whole pool is busy
+	Voice* voice = freeVoice;
+	if (numSame >= def.maxConcurrent_ && oldestSameVoice)
+		voice = oldestSameVoice;
+	else if (!voice)
+		voice = oldestVoice;
+	if (!voice)
+		return false;
+
+	if (voice->source_->IsPlaying())
+	{
+		++numStolen_;
+		GAME_LOG(LOGCAT_AUDIO, LOG_DEBUG, "Effect %d took a voice playing effect %d", effect, voice->effect_);
+	}
+
+	voice->effect_ = effect;
+	voice->stamp_ = ++stamp_;
+	voice->source_->SetGain(def.gain_);
+	voice->source_->Play(def.sound_);
+	return true;
+}
+
+void SoundPool::StopAll()
+{
+	for (unsigned i = 0; i < voices_.Size(); ++i)
+	{
+		if (voices_[i].source_)
+			voices_[i].source_->Stop();
+	}
+}
+
+unsigned SoundPool::GetNumPlaying() const
+{
+	unsigned num = 0;
+	for (unsigned i = 0; i < voices_.Size(); ++i)
+	{
+		if (voices_[i].source_ && voices_[i].source_->IsPlaying())
+			++num;
+	}
+	return num;
+}
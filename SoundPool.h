@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+
+namespace Urho3D
+{
+	class Node;
+	class Sound;
+	class SoundSource;
+}
+
+using namespace Urho3D;
+
+/// Sound effects played through the voice pool.
+enum SoundEffect
+{
+	SOUND_COLLECT = 0,
+	SOUND_HIT,
+	MAX_SOUND_EFFECTS
+};
+
+const unsigned NUM_SOUND_VOICES = 8;
+
+/// Fixed-size pool of pre-created SoundSource voices for one-shot effects.
+/// Sounds are resolved once per effect, so playing an effect never creates components or looks up resources.
+/// When all voices are busy (or the effect hit its concurrency limit) the oldest matching voice is restarted.
+class SoundPool : public Object
+{
+	URHO3D_OBJECT(SoundPool, Object);
+
+public:
+	/// Construct.
+	SoundPool(Context* context);
+	/// Destruct.
+	~SoundPool();
+
+	/// Create the voices on the given node. Previously created voices are released.
+	void CreateVoices(Node* node, unsigned numVoices = NUM_SOUND_VOICES);
+	/// Assign the sound, concurrency limit and gain of an effect.
+	void SetEffect(SoundEffect effect, Sound* sound, unsigned maxConcurrent, float gain = 1.0f);
+	/// Play an effect. Return false if there is no sound for it or no voices were created.
+	bool Play(SoundEffect effect);
+	/// Stop all voices.
+	void StopAll();
+
+	/// Return number of voices currently playing.
+	unsigned GetNumPlaying() const;
+	/// Return number of times a playing voice had to be stolen.
+	unsigned GetNumStolen() const { return numStolen_; }
+
+private:
+	/// Voice state.
+	struct Voice
+	{
+		/// Sound source component.
+		WeakPtr<SoundSource> source_;
+		/// Effect played last, or -1 if none.
+		int effect_;
+		/// Play order stamp, used to find the oldest voice.
+		unsigned stamp_;
+	};
+
+	/// Effect definition.
+	struct Effect
+	{
+		/// Resolved sound.
+		SharedPtr<Sound> sound_;
+		/// Max. voices playing this effect at once.
+		unsigned maxConcurrent_;
+		/// Voice gain.
+		float gain_;
+	};
+
+	/// Voices.
+	Vector<Voice> voices_;
+	/// Effects.
+	Effect effects_[MAX_SOUND_EFFECTS];
+	/// Play order counter.
+	unsigned stamp_;
+	/// Stolen voice counter.
+	unsigned numStolen_;
+};
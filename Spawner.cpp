@@ -0,0 +1,264 @@
+#include <Urho3D/Graphics/Material.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/ParticleEffect.h>
+#include <Urho3D/Graphics/ParticleEmitter.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/Physics/CollisionShape.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Node.h>
+
+#include "ModelLod.h"
+#include "Spawner.h"
+
+/// Spawn type names used in segment templates.
+static const char* spawnTypeNames[] =
+{
+	"Rock",
+	"DeadTree",
+	"Carrot",
+	"Floor",
+	"Grass",
+	"Wall",
+	"Tree2",
+	"Tree3",
+	0
+};
+
+/// LOD levels generated for the roadside tree models. LOD distances are camera distances divided by the average
+/// bounding box side, which is about 10 m for the trees, so the levels switch at roughly 20 m and 45 m.
+static const LodLevel treeLodLevels[] =
+{
+	{ 2.0f, 32 },
+	{ 4.5f, 12 }
+};
+
+Spawner::Spawner(Context* context) :
+	Object(context)
+{
+	for (unsigned i = 0; i < MAX_SPAWN_TYPES; ++i)
+		prototypes_[i] = 0;
+}
+
+Spawner::~Spawner()
+{
+}
+
+void Spawner::CreatePrototypes()
+{
+	ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+	root_ = new Node(context_);
+
+	// Rock in a lane, collision layer 3 ends the run
+	{
+		Node* node = CreatePrototype(SPAWN_ROCK, "Obstacle");
+		StaticModel* object = node->CreateComponent<StaticModel>();
+		object->SetModel(cache->GetResource<Model>("bin/Data/Models/skala/Models/Skala_low_poly_B.mdl"));
+		object->SetMaterial(cache->GetResource<Material>("Materials/Stone.xml"));
+		object->SetCastShadows(true);
+
+		RigidBody* body = node->CreateComponent<RigidBody>();
+		body->SetCollisionLayer(3);
+		CollisionShape* shape = node->CreateComponent<CollisionShape>();
+		shape->SetBox(Vector3::ONE);
+	}
+
+	// Dead tree lying across the path, collides with its actual mesh
+	{
+		Node* node = CreatePrototype(SPAWN_DEAD_TREE, "Obstacle");
+		StaticModel* object = node->CreateComponent<StaticModel>();
+		object->SetModel(cache->GetResource<Model>("bin/Data/Models/dead_tree/tree.mdl"));
+		object->SetMaterial(cache->GetResource<Material>("bin/Data/Models/dead_tree/bark.xml"));
+		object->SetCastShadows(true);
+
+		RigidBody* body = node->CreateComponent<RigidBody>();
+		body->SetCollisionLayer(3);
+		CollisionShape* shape = node->CreateComponent<CollisionShape>();
+		shape->SetTriangleMesh(object->GetModel(), 0);
+	}
+
+	// Carrot, a trigger on collision layer 4
+	{
+		Node* node = CreatePrototype(SPAWN_CARROT, "Carrot");
+		node->SetScale(0.2f);
+		StaticModel* object = node->CreateComponent<StaticModel>();
+		object->SetModel(cache->GetResource<Model>("bin/Data/Models/marchewka/Models/marchewka.mdl"));
+		object->SetMaterial(cache->GetResource<Material>("bin/Data/Models/marchewka/Materials/orange.xml"));
+		object->SetCastShadows(true);
+
+		RigidBody* body = node->CreateComponent<RigidBody>();
+		body->SetCollisionLayer(4);
+		body->SetTrigger(true);
+		CollisionShape* shape = node->CreateComponent<CollisionShape>();
+		shape->SetBox(Vector3::ONE);
+	}
+
+	// Floor tile of the path. Use collision layer bit 2 to mark world scenery. This is what we will raycast against to
+	// prevent camera from going inside geometry
+	{
+		Node* node = CreatePrototype(SPAWN_FLOOR, "Floor");
+		node->SetScale(Vector3(9.0f, 1.0f, 10.0f));
+		StaticModel* object = node->CreateComponent<StaticModel>();
+		object->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
+		object->SetMaterial(cache->GetResource<Material>("bin/Data/Materials/Path/pathM2.xml"));
+
+		RigidBody* body = node->CreateComponent<RigidBody>();
+		body->SetCollisionLayer(2);
+		CollisionShape* shape = node->CreateComponent<CollisionShape>();
+		shape->SetBox(Vector3::ONE);
+	}
+
+	// Grass tile beside the path, decoration only
+	{
+		Node* node = CreatePrototype(SPAWN_GRASS, "Landscape");
+		node->SetScale(Vector3(10.0f, 1.0f, 10.0f));
+		StaticModel* object = node->CreateComponent<StaticModel>();
+		object->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
+		object->SetMaterial(cache->GetResource<Material>("bin/Data/Materials/Path/grass.xml"));
+	}
+
+	// Side wall of the path
+	{
+		Node* node = CreatePrototype(SPAWN_WALL, "Wall");
+		node->SetScale(Vector3(1.0f, 4.0f, 10.0f));
+		StaticModel* object = node->CreateComponent<StaticModel>();
+		object->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
+		object->SetMaterial(cache->GetResource<Material>("Materials/Smoke.xml"));
+
+		RigidBody* body = node->CreateComponent<RigidBody>();
+		body->SetCollisionLayer(2);
+		CollisionShape* shape = node->CreateComponent<CollisionShape>();
+		shape->SetBox(Vector3::ONE);
+	}
+
+	// Roadside trees, trunk and leaves are separate models. The models have no LOD levels of their own, generate them
+	// before the first StaticModel uses them
+	{
+		ModelLod lod(context_);
+		const char* treeModels[] =
+		{
+			"bin/Data/Models/tree2/tree.mdl",
+			"bin/Data/Models/tree2/leaves.mdl",
+			"bin/Data/Models/tree3/tree.mdl",
+			"bin/Data/Models/tree3/leaves.mdl"
+		};
+		for (unsigned i = 0; i < sizeof treeModels / sizeof treeModels[0]; ++i)
+			lod.Generate(cache->GetResource<Model>(treeModels[i]), treeLodLevels, sizeof treeLodLevels / sizeof treeLodLevels[0]);
+	}
+	{
+		Node* node = CreatePrototype(SPAWN_TREE2, "Tree");
+		StaticModel* object = node->CreateComponent<StaticModel>();
+		object->SetModel(cache->GetResource<Model>("bin/Data/Models/tree2/tree.mdl"));
+		object->SetMaterial(cache->GetResource<Material>("bin/Data/Materials/torch_wood.xml"));
+		object->SetCastShadows(true);
+		object = node->CreateComponent<StaticModel>();
+		object->SetModel(cache->GetResource<Model>("bin/Data/Models/tree2/leaves.mdl"));
+		object->SetMaterial(cache->GetResource<Material>("bin/Data/Models/tree2/Material.004.xml"));
+		object->SetCastShadows(true);
+	}
+	{
+		Node* node = CreatePrototype(SPAWN_TREE3, "Tree");
+		StaticModel* object = node->CreateComponent<StaticModel>();
+		object->SetModel(cache->GetResource<Model>("bin/Data/Models/tree3/tree.mdl"));
+		object->SetMaterial(cache->GetResource<Material>("bin/Data/Materials/torch_wood.xml"));
+		object->SetCastShadows(true);
+		object = node->CreateComponent<StaticModel>();
+		object->SetModel(cache->GetResource<Model>("bin/Data/Models/tree3/leaves.mdl"));
+		object->SetMaterial(cache->GetResource<Material>("bin/Data/Models/tree3/Material.004.xml"));
+		object->SetCastShadows(true);
+	}
+}
+
+SpawnType Spawner::GetTypeByName(const String& name)
+{
+	for (unsigned i = 0; spawnTypeNames[i]; ++i)
+	{
+		if (name.Compare(spawnTypeNames[i], false) == 0)
+			return (SpawnType)i;
+	}
+	return MAX_SPAWN_TYPES;
+}
+
+Node* Spawner::CreatePrototype(SpawnType type, const String& name)
+{
+	Node* node = root_->CreateChild(name, LOCAL);
+	prototypes_[type] = node;
+	return node;
+}
+
+Node* Spawner::Spawn(SpawnType type, Node* parent, const Vector3& position, const Quaternion& rotation, float scale) const
+{
+	Node* prototype = prototypes_[type];
+	if (!prototype || !parent)
+		return 0;
+
+	Node* node = parent->CreateChild(prototype->GetName(), LOCAL);
+	node->SetTransform(position, rotation, prototype->GetScale() * scale);
+	CopyNode(prototype, node);
+	return node;
+}
+
+void Spawner::CopyNode(Node* source, Node* dest) const
+{
+	// The common components are copied through their setters with already resolved resources. Node::Clone would go
+	// through attributes and look up every resource by name again
+	const Vector<SharedPtr<Component> >& components = source->GetComponents();
+	for (unsigned i = 0; i < components.Size(); ++i)
+	{
+		Component* component = components[i];
+		StringHash type = component->GetType();
+
+		if (type == StaticModel::GetTypeStatic())
+		{
+			StaticModel* src = static_cast<StaticModel*>(component);
+			StaticModel* dst = dest->CreateComponent<StaticModel>(LOCAL);
+			dst->SetModel(src->GetModel());
+			for (unsigned j = 0; j < src->GetNumGeometries(); ++j)
+				dst->SetMaterial(j, src->GetMaterial(j));
+			dst->SetCastShadows(src->GetCastShadows());
+			dst->SetDrawDistance(src->GetDrawDistance());
+			dst->SetShadowDistance(src->GetShadowDistance());
+			dst->SetLodBias(src->GetLodBias());
+			dst->SetOccluder(src->IsOccluder());
+			dst->SetOccludee(src->IsOccludee());
+		}
+		else if (type == RigidBody::GetTypeStatic())
+		{
+			RigidBody* src = static_cast<RigidBody*>(component);
+			RigidBody* dst = dest->CreateComponent<RigidBody>(LOCAL);
+			dst->SetCollisionLayer(src->GetCollisionLayer());
+			dst->SetCollisionMask(src->GetCollisionMask());
+			dst->SetMass(src->GetMass());
+			dst->SetTrigger(src->IsTrigger());
+		}
+		else if (type == CollisionShape::GetTypeStatic() &&
+			(static_cast<CollisionShape*>(component)->GetShapeType() == SHAPE_BOX ||
+			static_cast<CollisionShape*>(component)->GetShapeType() == SHAPE_TRIANGLEMESH))
+		{
+			CollisionShape* src = static_cast<CollisionShape*>(component);
+			CollisionShape* dst = dest->CreateComponent<CollisionShape>(LOCAL);
+			if (src->GetShapeType() == SHAPE_BOX)
+				dst->SetBox(src->GetSize(), src->GetPosition(), src->GetRotation());
+			else
+				dst->SetTriangleMesh(src->GetModel(), src->GetLodLevel(), src->GetSize(), src->GetPosition(), src->GetRotation());
+		}
+		else if (type == ParticleEmitter::GetTypeStatic())
+		{
+			ParticleEmitter* src = static_cast<ParticleEmitter*>(component);
+			ParticleEmitter* dst = dest->CreateComponent<ParticleEmitter>(LOCAL);
+			dst->SetEffect(src->GetEffect());
+		}
+		else
+			dest->CloneComponent(component, LOCAL);
+	}
+
+	const Vector<SharedPtr<Node> >& children = source->GetChildren();
+	for (unsigned i = 0; i < children.Size(); ++i)
+	{
+		Node* child = children[i];
+		Node* clone = dest->CreateChild(child->GetName(), LOCAL);
+		clone->SetTransform(child->GetPosition(), child->GetRotation(), child->GetScale());
+		CopyNode(child, clone);
+	}
+}
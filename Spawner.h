@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Math/Quaternion.h>
+
+namespace Urho3D
+{
+	class Node;
+}
+
+using namespace Urho3D;
+
+/// Spawnable object types.
+enum SpawnType
+{
+	SPAWN_ROCK = 0,
+	SPAWN_DEAD_TREE,
+	SPAWN_CARROT,
+	SPAWN_FLOOR,
+	SPAWN_GRASS,
+	SPAWN_WALL,
+	SPAWN_TREE2,
+	SPAWN_TREE3,
+	MAX_SPAWN_TYPES
+};
+
+/// Prototype-and-clone spawner for segment content.
+/// One prototype node per spawnable type is built once, outside the scene, with all resources resolved. Spawning creates
+/// a node below the given parent and copies the prototype's components by pointer, without any resource lookups.
+class Spawner : public Object
+{
+	URHO3D_OBJECT(Spawner, Object);
+
+public:
+	/// Construct.
+	Spawner(Context* context);
+	/// Destruct.
+	~Spawner();
+
+	/// Build the prototypes of all spawn types.
+	void CreatePrototypes();
+	/// Return the prototype node of a spawn type.
+	Node* GetPrototype(SpawnType type) const { return prototypes_[type]; }
+	/// Return spawn type by name as used in segment templates, or MAX_SPAWN_TYPES if not found.
+	static SpawnType GetTypeByName(const String& name);
+
+	/// Instantiate a prototype below the parent node. The prototype's scale is multiplied by the given scale.
+	Node* Spawn(SpawnType type, Node* parent, const Vector3& position, const Quaternion& rotation = Quaternion::IDENTITY,
+		float scale = 1.0f) const;
+
+private:
+	/// Create an empty prototype node.
+	Node* CreatePrototype(SpawnType type, const String& name);
+	/// Copy the components and child nodes of a prototype node to an instance.
+	void CopyNode(Node* source, Node* dest) const;
+
+	/// Root node holding the prototypes, not part of any scene.
+	SharedPtr<Node> root_;
+	/// Prototype nodes.
+	Node* prototypes_[MAX_SPAWN_TYPES];
+};
@@ -0,0 +1,234 @@
+#include <Urho3D/Graphics/Geometry.h>
+#include <Urho3D/Graphics/IndexBuffer.h>
+#include <Urho3D/Graphics/Material.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/Graphics/VertexBuffer.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Scene/Node.h>
+
+#include "GameLog.h"
+#include "StaticBatcher.h"
+
+/// Names of the scenery nodes that are baked. Trees keep their own drawables for LOD and impostors, obstacles and
+/// carrots are removed individually.
+static const StringHash bakedNames[] =
+{
+	StringHash("Floor"),
+	StringHash("Landscape"),
+	StringHash("Wall")
+};
+
+StaticBatcher::StaticBatcher(Context* context) :
+	Object(context),
+	enabled_(true),
+	numRemoved_(0),
+	numCreated_(0),
+	numBytes_(0)
+{
+}
+
+StaticBatcher::~StaticBatcher()
+{
+}
+
+unsigned StaticBatcher::Bake(Node* segment)
+{
+	if (!enabled_ || !segment)
+		return 0;
+
+	// Group the geometries of the static scenery by material
+	HashMap<Material*, PODVector<Source> > groups;
+	PODVector<StaticModel*> models;
+	const Vector<SharedPtr<Node> >& children = segment->GetChildren();
+	for (unsigned i = 0; i < children.Size(); ++i)
+	{
+		Node* child = children[i];
+		bool baked = false;
+		for (unsigned j = 0; j < sizeof bakedNames / sizeof bakedNames[0]; ++j)
+			baked |= child->GetNameHash() == bakedNames[j];
+		if (!baked)
+			continue;
+
+		StaticModel* model = child->GetComponent<StaticModel>();
+		if (!model || !model->GetModel())
+			continue;
+
+		models.Push(model);
+		for (unsigned j = 0; j < model->GetNumGeometries(); ++j)
+		{
+			Source source;
+			source.model_ = model;
+			source.geometry_ = j;
+			groups[model->GetMaterial(j)].Push(source);
+		}
+	}
+
+	bool merged = true;
+	unsigned numBytes = 0;
+	for (HashMap<Material*, PODVector<Source> >::ConstIterator i = groups.Begin(); i != groups.End(); ++i)
+		merged &= Merge(segment, i->first_, i->second_, numBytes);
+
+	// Keep the originals if any group could not be merged, so nothing goes missing
+	if (!merged)
+	{
+		Node* baked = segment->GetChild("Baked");
+		if (baked)
+			baked->Remove();
+		return 0;
+	}
+
+	for (unsigned i = 0; i < models.Size(); ++i)
+	{
+		Node* node = models[i]->GetNode();
+		node->RemoveComponent(models[i]);
+		if (node->GetComponents().Empty())
+			node->Remove();
+	}
+
+	// The originals shared the vertex data of Box.mdl, the merged copies are the memory paid for the saved draw calls
+	GAME_LOG(LOGCAT_GENERATION, LOG_DEBUG, "Baked %s: %u drawables into %u, %u bytes of vertex and index data",
+		segment->GetName().CString(), models.Size(), groups.Size(), numBytes);
+
+	numRemoved_ += models.Size();
+	numCreated_ += groups.Size();
+	numBytes_ += numBytes;
+	return models.Size();
+}
+
+bool StaticBatcher::Merge(Node* segment, Material* material, const PODVector<Source>& sources, unsigned& numBytes)
+{
+	if (sources.Empty())
+		return false;
+
+	// All sources have to share the vertex layout of the first one
+	Geometry* firstGeometry = sources[0].model_->GetLodGeometry(sources[0].geometry_, 0);
+	VertexBuffer* firstBuffer = firstGeometry ? firstGeometry->GetVertexBuffer(0) : 0;
+	if (!firstBuffer)
+		return false;
+	const PODVector<VertexElement>& elements = firstBuffer->GetElements();
+	unsigned vertexSize = firstBuffer->GetVertexSize();
+	unsigned positionOffset = firstBuffer->GetElementOffset(SEM_POSITION);
+	unsigned normalOffset = firstBuffer->GetElementOffset(SEM_NORMAL);
+	unsigned tangentOffset = firstBuffer->GetElementOffset(SEM_TANGENT);
+	if (positionOffset == M_MAX_UNSIGNED)
+		return false;
+
+	PODVector<unsigned char> vertexData;
+	PODVector<unsigned> indices;
+	BoundingBox box;
+	bool castShadows = false;
+	bool occluder = false;
+	bool occludee = true;
+
+	for (unsigned i = 0; i < sources.Size(); ++i)
+	{
+		StaticModel* model = sources[i].model_;
+		Geometry* geometry = model->GetLodGeometry(sources[i].geometry_, 0);
+		VertexBuffer* vertexBuffer = geometry ? geometry->GetVertexBuffer(0) : 0;
+		IndexBuffer* indexBuffer = geometry ? geometry->GetIndexBuffer() : 0;
+		if (!vertexBuffer || !indexBuffer || !vertexBuffer->GetShadowData() || !indexBuffer->GetShadowData() ||
+			vertexBuffer->GetElementMask() != firstBuffer->GetElementMask() || vertexBuffer->GetVertexSize() != vertexSize ||
+			geometry->GetPrimitiveType() != TRIANGLE_LIST)
+			return false;
+
+		// Segment children only, so the node transform is the transform in segment space
+		Matrix3x4 transform = model->GetNode()->GetTransform();
+		Matrix3 rotation = transform.ToMatrix3();
+		Matrix3 normalTransform = rotation.Inverse().Transpose();
+
+		unsigned vertexStart = geometry->GetVertexStart();
+		unsigned vertexCount = geometry->GetVertexCount();
+		unsigned baseVertex = vertexData.Size() / vertexSize;
+		vertexData.Resize(vertexData.Size() + vertexCount * vertexSize);
+		unsigned char* dest = &vertexData[baseVertex * vertexSize];
+		memcpy(dest, vertexBuffer->GetShadowData() + vertexStart * vertexSize, vertexCount * vertexSize);
+
+		for (unsigned j = 0; j < vertexCount; ++j)
+		{
+			unsigned char* vertex = dest + j * vertexSize;
+			Vector3& position = *reinterpret_cast<Vector3*>(vertex + positionOffset);
+			position = transform * position;
+			box.Merge(position);
+			if (normalOffset != M_MAX_UNSIGNED)
+			{
+				Vector3& normal = *reinterpret_cast<Vector3*>(vertex + normalOffset);
+				normal = (normalTransform * normal).Normalized();
+			}
+			if (tangentOffset != M_MAX_UNSIGNED)
+			{
+				Vector4& tangent = *reinterpret_cast<Vector4*>(vertex + tangentOffset);
+				Vector3 direction = (rotation * Vector3(tangent.x_, tangent.y_, tangent.z_)).Normalized();
+				tangent = Vector4(direction, tangent.w_);
+			}
+		}
+
+		const unsigned char* indexData = indexBuffer->GetShadowData();
+		bool largeIndices = indexBuffer->GetIndexSize() == sizeof(unsigned);
+		unsigned indexStart = geometry->GetIndexStart();
+		unsigned indexCount = geometry->GetIndexCount();
+		for (unsigned j = indexStart; j < indexStart + indexCount; ++j)
+		{
+			unsigned index = largeIndices ? ((const unsigned*)indexData)[j] : ((const unsigned short*)indexData)[j];
+			indices.Push(index - vertexStart + baseVertex);
+		}
+
+		castShadows |= model->GetCastShadows();
+		occluder |= model->IsOccluder();
+		occludee &= model->IsOccludee();
+	}
+
+	unsigned numVertices = vertexData.Size() / vertexSize;
+	bool largeIndices = numVertices > 65535;
+
+	SharedPtr<VertexBuffer> vertexBuffer(new VertexBuffer(context_));
+	vertexBuffer->SetShadowed(true);
+	vertexBuffer->SetSize(numVertices, elements);
+	vertexBuffer->SetData(&vertexData[0]);
+
+	SharedPtr<IndexBuffer> indexBuffer(new IndexBuffer(context_));
+	indexBuffer->SetShadowed(true);
+	indexBuffer->SetSize(indices.Size(), largeIndices);
+	if (largeIndices)
+		indexBuffer->SetData(&indices[0]);
+	else
+	{
+		PODVector<unsigned short> shortIndices(indices.Size());
+		for (unsigned i = 0; i < indices.Size(); ++i)
+			shortIndices[i] = (unsigned short)indices[i];
+		indexBuffer->SetData(&shortIndices[0]);
+	}
+
+	SharedPtr<Geometry> geometry(new Geometry(context_));
+	geometry->SetNumVertexBuffers(1);
+	geometry->SetVertexBuffer(0, vertexBuffer);
+	geometry->SetIndexBuffer(indexBuffer);
+	geometry->SetDrawRange(TRIANGLE_LIST, 0, indices.Size());
+
+	SharedPtr<Model> model(new Model(context_));
+	Vector<SharedPtr<VertexBuffer> > vertexBuffers;
+	vertexBuffers.Push(vertexBuffer);
+	Vector<SharedPtr<IndexBuffer> > indexBuffers;
+	indexBuffers.Push(indexBuffer);
+	PODVector<unsigned> morphRangeStarts(1, 0);
+	PODVector<unsigned> morphRangeCounts(1, 0);
+	model->SetVertexBuffers(vertexBuffers, morphRangeStarts, morphRangeCounts);
+	model->SetIndexBuffers(indexBuffers);
+	model->SetNumGeometries(1);
+	model->SetNumGeometryLodLevels(0, 1);
+	model->SetGeometry(0, 0, geometry);
+	model->SetBoundingBox(box);
+
+	Node* baked = segment->GetChild("Baked");
+	if (!baked)
+		baked = segment->CreateChild("Baked", LOCAL);
+	StaticModel* bakedModel = baked->CreateComponent<StaticModel>(LOCAL);
+	bakedModel->SetModel(model);
+	bakedModel->SetMaterial(material);
+	bakedModel->SetCastShadows(castShadows);
+	bakedModel->SetOccluder(occluder);
+	bakedModel->SetOccludee(occludee);
+
+	numBytes += vertexData.Size() + indices.Size() * indexBuffer->GetIndexSize();
+	return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+
+namespace Urho3D
+{
+	class Material;
+	class Node;
+	class StaticModel;
+}
+
+using namespace Urho3D;
+
+/// Merges the static scenery boxes of a segment into one model per material.
+/// The floor, grass and wall tiles of a segment never move. Baking copies their vertices, transformed into segment
+/// space, into a new vertex and index buffer per material and removes their StaticModels; physics components stay on
+/// the original nodes. This trades extra vertex memory for far fewer drawables, octree entries and batches.
+class StaticBatcher : public Object
+{
+	URHO3D_OBJECT(StaticBatcher, Object);
+
+public:
+	/// Construct.
+	StaticBatcher(Context* context);
+	/// Destruct.
+	~StaticBatcher();
+
+	/// Bake the static scenery of a segment. Return number of drawables removed.
+	unsigned Bake(Node* segment);
+	/// Enable or disable baking.
+	void SetEnabled(bool enable) { enabled_ = enable; }
+
+	/// Return whether baking is enabled.
+	bool IsEnabled() const { return enabled_; }
+	/// Return total number of drawables removed by baking.
+	unsigned GetNumRemoved() const { return numRemoved_; }
+	/// Return total number of drawables created by baking.
+	unsigned GetNumCreated() const { return numCreated_; }
+	/// Return total bytes of vertex and index data created by baking.
+	unsigned GetNumBytes() const { return numBytes_; }
+
+private:
+	/// Source geometry of a merged model.
+	struct Source
+	{
+		/// Drawable.
+		StaticModel* model_;
+		/// Geometry index.
+		unsigned geometry_;
+	};
+
+	/// Merge sources sharing a material into a new drawable below the segment and add the size of the new buffers to
+	/// numBytes. Return false if the sources could not be merged.
+	bool Merge(Node* segment, Material* material, const PODVector<Source>& sources, unsigned& numBytes);
+
+	/// Baking enabled.
+	bool enabled_;
+	/// Drawables removed.
+	unsigned numRemoved_;
+	/// Drawables created.
+	unsigned numCreated_;
+	/// Bytes of vertex and index data created.
+	unsigned numBytes_;
+};
@@ -24,19 +24,47 @@
 #include <Urho3D/Graphics/Renderer.h>
 #include <Urho3D/Input/Controls.h>
 #include <Urho3D/Input/Input.h>
+#include <Urho3D/Input/InputEvents.h>
+#include <Urho3D/UI/UI.h>
 
 #include "Character.h"
+#include "LatencyTracer.h"
 #include "Touch.h"
 
 const float GYROSCOPE_THRESHOLD = 0.1f;
+/// Distance a finger has to travel for a swipe, as a fraction of the screen height.
+const float SWIPE_MIN_DISTANCE = 0.06f;
+/// Longest time a swipe may take, in microseconds.
+const long long SWIPE_MAX_TIME = 400000;
+/// Farthest a finger may travel for a tap, as a fraction of the screen height.
+const float TAP_MAX_DISTANCE = 0.02f;
+/// Longest time a tap may take, in microseconds.
+const long long TAP_MAX_TIME = 250000;
+/// Time the lane control of a swipe is held, about as long as a key press.
+const float LANE_HOLD_TIME = 0.25f;
+
+/// Return vector between two screen positions.
+static Vector2 ScreenDelta(const IntVector2& from, const IntVector2& to)
+{
+	return Vector2((float)(to.x_ - from.x_), (float)(to.y_ - from.y_));
+}
 
 Touch::Touch(Context* context, float touchSensitivity) :
 	Object(context),
 	touchSensitivity_(touchSensitivity),
 	cameraDistance_(CAMERA_INITIAL_DIST),
 	zoom_(false),
-	useGyroscope_(false)
+	useGyroscope_(false),
+	laneHoldTime_(0.0f),
+	laneControl_(0),
+	lastGesture_(GESTURE_NONE),
+	latency_(0.0f),
+	maxLatency_(0.0f)
 {
+	// Gestures are recognized as soon as the events arrive, not when the touches are next polled
+	SubscribeToEvent(E_TOUCHBEGIN, URHO3D_HANDLER(Touch, HandleTouchBegin));
+	SubscribeToEvent(E_TOUCHMOVE, URHO3D_HANDLER(Touch, HandleTouchMove));
+	SubscribeToEvent(E_TOUCHEND, URHO3D_HANDLER(Touch, HandleTouchEnd));
 }
 
 Touch::~Touch()
@@ -45,35 +73,8 @@ Touch::~Touch()
 
 void Touch::UpdateTouches(Controls& controls) // Called from HandleUpdate
 {
-	zoom_ = false; // reset bool
-
 	Input* input = GetSubsystem<Input>();
 
-	// Zoom in/out
-	if (input->GetNumTouches() == 2)
-	{
-		TouchState* touch1 = input->GetTouch(0);
-		TouchState* touch2 = input->GetTouch(1);
-
-		// Check for zoom pattern (touches moving in opposite directions and on empty space)
-		if (!touch1->touchedElement_ && !touch2->touchedElement_ && ((touch1->delta_.y_ > 0 && touch2->delta_.y_ < 0) || (touch1->delta_.y_ < 0 && touch2->delta_.y_ > 0)))
-			zoom_ = true;
-		else
-			zoom_ = false;
-
-		if (zoom_)
-		{
-			int sens = 0;
-			// Check for zoom direction (in/out)
-			if (Abs(touch1->position_.y_ - touch2->position_.y_) > Abs(touch1->lastPosition_.y_ - touch2->lastPosition_.y_))
-				sens = -1;
-			else
-				sens = 1;
-			cameraDistance_ += Abs(touch1->delta_.y_ - touch2->delta_.y_) * sens * touchSensitivity_ / 50.0f;
-			cameraDistance_ = Clamp(cameraDistance_, CAMERA_MIN_DIST, CAMERA_MAX_DIST); // Restrict zoom range to [1;20]
-		}
-	}
-
 	// Gyroscope (emulated by SDL through a virtual joystick)
 	if (useGyroscope_ && input->GetNumJoysticks() > 0)  // numJoysticks = 1 on iOS & Android
 	{
@@ -91,3 +92,170 @@ void Touch::UpdateTouches(Controls& controls) // Called from HandleUpdate
 		}
 	}
 }
+
+unsigned Touch::ApplyGestures(Controls& controls, float timeStep) // Called at the start of each fixed step
+{
+	long long now = timer_.GetUSec(false);
+	unsigned pressed = 0;
+	for (unsigned i = 0; i < gestures_.Size(); ++i)
+	{
+		unsigned control = GetGestureControl(gestures_[i]);
+		if (control == CTRL_JUMP)
+			controls.Set(CTRL_JUMP, true);
+		else if (control)
+		{
+			laneControl_ = control;
+			laneHoldTime_ = LANE_HOLD_TIME;
+		}
+		pressed |= control;
+
+		// The impulse of the gesture is applied in this step, measure from the event that completed it
+		latency_ = (now - gestureTimes_[i]) / 1000.0f;
+		maxLatency_ = Max(maxLatency_, latency_);
+	}
+	gestures_.Clear();
+	gestureTimes_.Clear();
+
+	if (laneHoldTime_ > 0.0f)
+	{
+		controls.Set(laneControl_, true);
+		laneHoldTime_ -= timeStep;
+	}
+
+	return pressed;
+}
+
+void Touch::SetLatencyTracer(LatencyTracer* tracer)
+{
+	latencyTracer_ = tracer;
+}
+
+void Touch::ClearGestures()
+{
+	gestures_.Clear();
+	gestureTimes_.Clear();
+	laneHoldTime_ = 0.0f;
+	laneControl_ = 0;
+}
+
+void Touch::HandleTouchBegin(StringHash eventType, VariantMap& eventData)
+{
+	using namespace TouchBegin;
+
+	IntVector2 position(eventData[P_X].GetInt(), eventData[P_Y].GetInt());
+
+	// Touches on the screen joystick or other UI are not gestures
+	if (GetSubsystem<UI>()->GetElementAt(position, true))
+		return;
+
+	TrackedTouch touch;
+	touch.id_ = eventData[P_TOUCHID].GetInt();
+	touch.start_ = position;
+	touch.position_ = position;
+	touch.startTime_ = timer_.GetUSec(false);
+	touch.recognized_ = false;
+	touches_.Push(touch);
+}
+
+void Touch::HandleTouchMove(StringHash eventType, VariantMap& eventData)
+{
+	using namespace TouchMove;
+
+	TrackedTouch* touch = FindTouch(eventData[P_TOUCHID].GetInt());
+	if (!touch)
+		return;
+
+	IntVector2 position(eventData[P_X].GetInt(), eventData[P_Y].GetInt());
+	float height = (float)GetSubsystem<Graphics>()->GetHeight();
+
+	// Two fingers: zoom by the change of their distance, neither of them makes a swipe any more
+	if (touches_.Size() == 2)
+	{
+		TrackedTouch& other = touches_[touch == &touches_[0] ? 1 : 0];
+		float oldDistance = ScreenDelta(other.position_, touch->position_).Length();
+		float newDistance = ScreenDelta(other.position_, position).Length();
+		touch->position_ = position;
+		touches_[0].recognized_ = true;
+		touches_[1].recognized_ = true;
+
+		zoom_ = newDistance != oldDistance;
+		cameraDistance_ += (oldDistance - newDistance) * touchSensitivity_ / 50.0f;
+		cameraDistance_ = Clamp(cameraDistance_, CAMERA_MIN_DIST, CAMERA_MAX_DIST); // Restrict zoom range to [1;20]
+		return;
+	}
+
+	touch->position_ = position;
+	if (touch->recognized_ || timer_.GetUSec(false) - touch->startTime_ > SWIPE_MAX_TIME)
+		return;
+
+	// Recognize the swipe while the finger is still moving, waiting for it to lift would add its whole travel time
+	Vector2 travel = ScreenDelta(touch->start_, touch->position_);
+	if (travel.Length() < SWIPE_MIN_DISTANCE * height)
+		return;
+
+	touch->recognized_ = true;
+	if (Abs(travel.x_) > Abs(travel.y_))
+		QueueGesture(travel.x_ < 0.0f ? GESTURE_SWIPE_LEFT : GESTURE_SWIPE_RIGHT);
+	else if (travel.y_ < 0.0f)
+		QueueGesture(GESTURE_SWIPE_UP);
+}
+
+void Touch::HandleTouchEnd(StringHash eventType, VariantMap& eventData)
+{
+	using namespace TouchEnd;
+
+	int id = eventData[P_TOUCHID].GetInt();
+	for (unsigned i = 0; i < touches_.Size(); ++i)
+	{
+		TrackedTouch& touch = touches_[i];
+		if (touch.id_ != id)
+			continue;
+
+		float height = (float)GetSubsystem<Graphics>()->GetHeight();
+		IntVector2 position(eventData[P_X].GetInt(), eventData[P_Y].GetInt());
+		if (!touch.recognized_ && ScreenDelta(touch.start_, position).Length() < TAP_MAX_DISTANCE * height &&
+			timer_.GetUSec(false) - touch.startTime_ < TAP_MAX_TIME)
+			QueueGesture(GESTURE_TAP);
+
+		touches_.Erase(i);
+		break;
+	}
+
+	if (touches_.Size() < 2)
+		zoom_ = false;
+}
+
+void Touch::QueueGesture(TouchGesture gesture)
+{
+	gestures_.Push(gesture);
+	gestureTimes_.Push(timer_.GetUSec(false));
+	lastGesture_ = gesture;
+	if (latencyTracer_)
+		latencyTracer_->Begin(GetGestureControl(gesture));
+}
+
+unsigned Touch::GetGestureControl(TouchGesture gesture) const
+{
+	switch (gesture)
+	{
+	case GESTURE_SWIPE_LEFT:
+		return CTRL_LEFT;
+	case GESTURE_SWIPE_RIGHT:
+		return CTRL_RIGHT;
+	case GESTURE_SWIPE_UP:
+	case GESTURE_TAP:
+		return CTRL_JUMP;
+	default:
+		return 0;
+	}
+}
+
+Touch::TrackedTouch* Touch::FindTouch(int id)
+{
+	for (unsigned i = 0; i < touches_.Size(); ++i)
+	{
+		if (touches_[i].id_ == id)
+			return &touches_[i];
+	}
+	return 0;
+}
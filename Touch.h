@@ -1,6 +1,8 @@
 #pragma once
 
 #include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Math/Vector2.h>
 
 using namespace Urho3D;
 
@@ -9,19 +11,32 @@ namespace Urho3D
 	class Controls;
 }
 
+class LatencyTracer;
+
 const float CAMERA_MIN_DIST = 1.0f;
 const float CAMERA_INITIAL_DIST = 5.0f;
 const float CAMERA_MAX_DIST = 20.0f;
 
+/// Recognized touch gestures.
+enum TouchGesture
+{
+	GESTURE_NONE = 0,
+	GESTURE_SWIPE_LEFT,
+	GESTURE_SWIPE_RIGHT,
+	GESTURE_SWIPE_UP,
+	GESTURE_TAP
+};
+
 /// Mobile framework for Android/iOS
 /// Gamepad from NinjaSnowWar
-/// Touches patterns:
-///     - 1 finger touch  = pick object through raycast
-///     - 1 or 2 fingers drag  = rotate camera
-///     - 2 fingers sliding in opposite direction (up/down) = zoom in/out
+/// Touches patterns, recognized from the touch events as they arrive:
+///     - 1 finger swipe left/right = change lane
+///     - 1 finger swipe up or tap = jump
+///     - 2 fingers pinch = zoom in/out
 ///
 /// Setup:
-/// - Call the update function 'UpdateTouches()' from HandleUpdate or equivalent update handler function
+/// - Call the update function 'UpdateTouches()' from HandleUpdate or equivalent update handler function for the gyroscope
+/// - Call 'ApplyGestures()' at the start of each fixed step, before the controls are used
 class Touch : public Object
 {
 	URHO3D_OBJECT(Touch, Object);
@@ -32,8 +47,22 @@ public:
 	/// Destruct.
 	~Touch();
 
-	/// Update touch controls for the current frame.
+	/// Update gyroscope controls for the current frame.
 	void UpdateTouches(Controls& controls);
+	/// Add the controls of the recognized gestures for a fixed step and measure their latency. Return the controls the
+	/// gestures pressed in the step.
+	unsigned ApplyGestures(Controls& controls, float timeStep);
+	/// Set the input latency tracer, started by the recognized gestures.
+	void SetLatencyTracer(LatencyTracer* tracer);
+	/// Drop the queued gestures and release the held lane control.
+	void ClearGestures();
+
+	/// Return last recognized gesture.
+	TouchGesture GetLastGesture() const { return lastGesture_; }
+	/// Return latency from the touch event to the fixed step of the last gesture, in milliseconds.
+	float GetLatency() const { return latency_; }
+	/// Return highest latency so far, in milliseconds.
+	float GetMaxLatency() const { return maxLatency_; }
 
 	/// Touch sensitivity.
 	float touchSensitivity_;
@@ -43,5 +72,55 @@ public:
 	bool zoom_;
 	/// Gyroscope on/off flag.
 	bool useGyroscope_;
+
+private:
+	/// Touch being tracked for a gesture.
+	struct TrackedTouch
+	{
+		/// Touch ID.
+		int id_;
+		/// Position at touch begin.
+		IntVector2 start_;
+		/// Current position.
+		IntVector2 position_;
+		/// Time of touch begin in microseconds.
+		long long startTime_;
+		/// Already recognized as a swipe.
+		bool recognized_;
+	};
+
+	/// Handle touch begin event.
+	void HandleTouchBegin(StringHash eventType, VariantMap& eventData);
+	/// Handle touch move event.
+	void HandleTouchMove(StringHash eventType, VariantMap& eventData);
+	/// Handle touch end event.
+	void HandleTouchEnd(StringHash eventType, VariantMap& eventData);
+	/// Queue a recognized gesture.
+	void QueueGesture(TouchGesture gesture);
+	/// Return the control a gesture presses.
+	unsigned GetGestureControl(TouchGesture gesture) const;
+	/// Return tracked touch by ID, or null.
+	TrackedTouch* FindTouch(int id);
+
+	/// Input latency tracer.
+	WeakPtr<LatencyTracer> latencyTracer_;
+	/// Timer the touch events are stamped with.
+	HiresTimer timer_;
+	/// Touches being tracked.
+	PODVector<TrackedTouch> touches_;
+	/// Gestures waiting for the next fixed step.
+	PODVector<TouchGesture> gestures_;
+	/// Event times of the waiting gestures in microseconds.
+	PODVector<long long> gestureTimes_;
+	/// Remaining time the lane control of a swipe is held.
+	float laneHoldTime_;
+	/// Lane control held.
+	int laneControl_;
+	/// Last recognized gesture.
+	TouchGesture lastGesture_;
+	/// Latency of the last gesture in milliseconds.
+	float latency_;
+	/// Highest latency in milliseconds.
+	float maxLatency_;
 };
 
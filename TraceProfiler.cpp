@@ -0,0 +1,80 @@
+#include <cstdio>
+
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+
+#include "TraceProfiler.h"
+
+TraceProfiler* TraceProfiler::instance_ = 0;
+
+TraceProfiler::TraceProfiler(Context* context) :
+	Object(context),
+	recording_(false)
+{
+	instance_ = this;
+}
+
+TraceProfiler::~TraceProfiler()
+{
+	if (recording_)
+		StopSession();
+	instance_ = 0;
+}
+
+void TraceProfiler::StartSession(const String& directory)
+{
+	directory_ = AddTrailingSlash(directory);
+	events_.Clear();
+	recording_ = true;
+}
+
+bool TraceProfiler::StopSession()
+{
+	if (!recording_)
+		return false;
+	recording_ = false;
+
+	FileSystem* fileSystem = GetSubsystem<FileSystem>();
+	fileSystem->CreateDir(directory_);
+	fileName_ = directory_ + "trace_" + Time::GetTimeStamp().Replaced(':', '_').Replaced(' ', '_') + ".json";
+
+	File file(context_, fileName_, FILE_WRITE);
+	if (!file.IsOpen())
+	{
+		URHO3D_LOGERROR("Could not write trace " + fileName_);
+		return false;
+	}
+
+	// Complete events ("ph":"X") carry start and duration in microseconds, nesting is worked out by the viewer
+	// Urho's string formatter has no 64-bit integers, format the lines with snprintf instead. WriteString is avoided
+	// as it would also write the terminating null
+	static const char header[] = "{\"traceEvents\":[\n";
+	static const char footer[] = "],\"displayTimeUnit\":\"ms\"}\n";
+	file.Write(header, sizeof header - 1);
+	char line[256];
+	for (unsigned i = 0; i < events_.Size(); ++i)
+	{
+		const TraceEvent& event = events_[i];
+		int length = snprintf(line, sizeof line, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":1}%s\n",
+			event.name_, event.start_, event.duration_, i + 1 < events_.Size() ? "," : "");
+		file.Write(line, (unsigned)Min(length, (int)sizeof line - 1));
+	}
+	file.Write(footer, sizeof footer - 1);
+
+	URHO3D_LOGINFOF("Wrote %u trace events to %s", events_.Size(), fileName_.CString());
+	events_.Clear();
+	return true;
+}
+
+void TraceProfiler::Add(const char* name, long long start)
+{
+	if (!recording_ || events_.Size() >= MAX_TRACE_EVENTS)
+		return;
+
+	TraceEvent event;
+	event.name_ = name;
+	event.start_ = start;
+	event.duration_ = timer_.GetUSec(false) - start;
+	events_.Push(event);
+}
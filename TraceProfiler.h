@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Profiler.h>
+#include <Urho3D/Core/Timer.h>
+
+using namespace Urho3D;
+
+/// Largest number of scopes recorded in one session.
+const unsigned MAX_TRACE_EVENTS = 262144;
+
+/// Profile the rest of the scope as a named block in the engine profiler and, while recording, in the trace.
+#define GAME_PROFILE(name) \
+	URHO3D_PROFILE(name); \
+	TraceScope traceScope_ ## name(#name)
+
+/// Records timed scopes of the main thread and exports them as Chrome trace-event JSON.
+/// A session runs from StartSession to StopSession; the scopes are kept in memory and written to one file when the
+/// session stops, which can be opened in chrome://tracing or Perfetto to inspect hitches on a timeline.
+class TraceProfiler : public Object
+{
+	URHO3D_OBJECT(TraceProfiler, Object);
+
+public:
+	/// Construct.
+	TraceProfiler(Context* context);
+	/// Write the running session, if any.
+	~TraceProfiler();
+
+	/// Start recording a session that is written to the given directory when it stops.
+	void StartSession(const String& directory);
+	/// Stop recording and write the session to a file. Return false if it could not be written.
+	bool StopSession();
+	/// Add a scope that started at the given time and ends now.
+	void Add(const char* name, long long start);
+
+	/// Return microseconds since the profiler was created.
+	long long GetTime() const { return timer_.GetUSec(false); }
+	/// Return whether a session is recording.
+	bool IsRecording() const { return recording_; }
+	/// Return name of the last file written.
+	const String& GetFileName() const { return fileName_; }
+	/// Return the trace profiler instance, or null if none exists.
+	static TraceProfiler* GetInstance() { return instance_; }
+
+private:
+	/// Recorded scope.
+	struct TraceEvent
+	{
+		/// Scope name, a string literal.
+		const char* name_;
+		/// Start time in microseconds.
+		long long start_;
+		/// Duration in microseconds.
+		long long duration_;
+	};
+
+	/// Timer the scopes are stamped with.
+	mutable HiresTimer timer_;
+	/// Scopes of the session.
+	PODVector<TraceEvent> events_;
+	/// Recording flag.
+	bool recording_;
+	/// Directory the session is written to.
+	String directory_;
+	/// Last file written.
+	String fileName_;
+
+	/// The trace profiler instance.
+	static TraceProfiler* instance_;
+};
+
+/// Times a scope for the trace profiler while a session is recording.
+class TraceScope
+{
+public:
+	/// Construct and note the start time.
+	TraceScope(const char* name) :
+		name_(name),
+		start_(-1)
+	{
+		TraceProfiler* profiler = TraceProfiler::GetInstance();
+		if (profiler && profiler->IsRecording())
+			start_ = profiler->GetTime();
+	}
+
+	/// Destruct and record the scope.
+	~TraceScope()
+	{
+		TraceProfiler* profiler = TraceProfiler::GetInstance();
+		if (start_ >= 0 && profiler)
+			profiler->Add(name_, start_);
+	}
+
+private:
+	/// Scope name.
+	const char* name_;
+	/// Start time, negative if not recording.
+	long long start_;
+};
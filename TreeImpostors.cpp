@@ -0,0 +1,241 @@
+#include <Urho3D/Graphics/BillboardSet.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/Graphics/Light.h>
+#include <Urho3D/Graphics/Material.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/RenderSurface.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/Graphics/Technique.h>
+#include <Urho3D/Graphics/Texture2D.h>
+#include <Urho3D/Graphics/Viewport.h>
+#include <Urho3D/Graphics/Zone.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "TreeImpostors.h"
+
+/// Tree variants that get an impostor.
+static const SpawnType impostorTypes[] =
+{
+	SPAWN_TREE2,
+	SPAWN_TREE3
+};
+
+/// Distance the variants are kept apart in the impostor scene, so each camera only sees its own tree.
+static const float VARIANT_SPACING = 100.0f;
+/// Margin between the swap distances in both directions, so trees right at the distance do not flicker.
+static const float IMPOSTOR_HYSTERESIS = 2.0f;
+
+/// How a tree is drawn.
+enum TreeState
+{
+	TREE_MODEL = 0,
+	TREE_IMPOSTOR,
+	TREE_HIDDEN
+};
+
+TreeImpostors::TreeImpostors(Context* context) :
+	Object(context),
+	impostorDistance_(IMPOSTOR_DISTANCE),
+	cullDistance_(M_INFINITY),
+	numImpostors_(0)
+{
+}
+
+TreeImpostors::~TreeImpostors()
+{
+}
+
+void TreeImpostors::Create(Spawner* spawner)
+{
+	// Without graphics there is nothing to render the atlas with, the trees then always stay full models
+	if (!GetSubsystem<Graphics>())
+		return;
+
+	ResourceCache* cache = GetSubsystem<ResourceCache>();
+	const unsigned numVariants = sizeof impostorTypes / sizeof impostorTypes[0];
+
+	atlas_ = new Texture2D(context_);
+	atlas_->SetSize(IMPOSTOR_CELL_SIZE * numVariants, IMPOSTOR_CELL_SIZE, Graphics::GetRGBAFormat(), TEXTURE_RENDERTARGET);
+	atlas_->SetFilterMode(FILTER_BILINEAR);
+
+	// Small scene with the same light direction as the game, transparent background
+	scene_ = new Scene(context_);
+	scene_->CreateComponent<Octree>();
+	Zone* zone = scene_->CreateComponent<Zone>();
+	zone->SetBoundingBox(BoundingBox(-1000.0f, 1000.0f));
+	zone->SetAmbientColor(Color(0.15f, 0.15f, 0.15f));
+	zone->SetFogColor(Color(0.0f, 0.0f, 0.0f, 0.0f));
+	zone->SetFogStart(1000.0f);
+	zone->SetFogEnd(1000.0f);
+	Node* lightNode = scene_->CreateChild("DirectionalLight");
+	lightNode->SetDirection(Vector3(0.3f, -2.0f, 0.425f));
+	Light* light = lightNode->CreateComponent<Light>();
+	light->SetLightType(LIGHT_DIRECTIONAL);
+
+	RenderSurface* surface = atlas_->GetRenderSurface();
+	surface->SetNumViewports(numVariants);
+	surface->SetUpdateMode(SURFACE_MANUALUPDATE);
+
+	for (unsigned i = 0; i < numVariants; ++i)
+	{
+		Node* prototype = spawner->GetPrototype(impostorTypes[i]);
+		if (!prototype)
+			continue;
+
+		Node* tree = spawner->Spawn(impostorTypes[i], scene_, Vector3(i * VARIANT_SPACING, 0.0f, 0.0f));
+
+		// Fit the cell around the tree as seen from the path
+		BoundingBox box;
+		PODVector<StaticModel*> models;
+		tree->GetComponents<StaticModel>(models);
+		for (unsigned j = 0; j < models.Size(); ++j)
+			box.Merge(models[j]->GetWorldBoundingBox());
+		if (!box.Defined())
+			continue;
+		Vector3 center = box.Center();
+		Vector3 size = box.Size();
+		float extent = Max(size.x_, size.y_);
+
+		Node* cameraNode = scene_->CreateChild("Camera");
+		cameraNode->SetPosition(Vector3(center.x_, center.y_, box.min_.z_ - 10.0f));
+		Camera* camera = cameraNode->CreateComponent<Camera>();
+		camera->SetOrthographic(true);
+		camera->SetOrthoSize(extent);
+		camera->SetAspectRatio(1.0f);
+		camera->SetFarClip(size.z_ + 20.0f);
+
+		IntRect rect(i * IMPOSTOR_CELL_SIZE, 0, (i + 1) * IMPOSTOR_CELL_SIZE, IMPOSTOR_CELL_SIZE);
+		surface->SetViewport(i, new Viewport(context_, scene_, camera, rect));
+
+		Variant variant;
+		variant.prototype_ = prototype;
+		variant.uv_ = Rect((float)i / numVariants, 0.0f, (float)(i + 1) / numVariants, 1.0f);
+		variant.size_ = Vector2(extent * 0.5f, extent * 0.5f);
+		variant.height_ = center.y_;
+		variants_.Push(variant);
+	}
+
+	// Render the cells once, the atlas keeps its content afterwards
+	surface->QueueUpdate();
+
+	material_ = new Material(context_);
+	material_->SetTechnique(0, cache->GetResource<Technique>("Techniques/DiffUnlitAlphaMask.xml"));
+	material_->SetTexture(TU_DIFFUSE, atlas_);
+}
+
+void TreeImpostors::AddSegment(Node* segment)
+{
+	if (!segment || variants_.Empty())
+		return;
+
+	static const StringHash treeName("Tree");
+
+	Group group;
+	const Vector<SharedPtr<Node> >& children = segment->GetChildren();
+	for (unsigned i = 0; i < children.Size(); ++i)
+	{
+		if (children[i]->GetNameHash() == treeName && GetVariant(children[i]))
+			group.trees_.Push(children[i]);
+	}
+	if (group.trees_.Empty())
+		return;
+	group.states_.Resize(group.trees_.Size());
+
+	Node* billboardNode = segment->CreateChild("Impostors", LOCAL);
+	BillboardSet* billboards = billboardNode->CreateComponent<BillboardSet>(LOCAL);
+	billboards->SetMaterial(material_);
+	billboards->SetNumBillboards(group.trees_.Size());
+	billboards->SetSorted(false);
+	billboards->SetFaceCameraMode(FC_ROTATE_Y);
+
+	for (unsigned i = 0; i < group.trees_.Size(); ++i)
+	{
+		Node* tree = group.trees_[i];
+		const Variant* variant = GetVariant(tree);
+		float scale = tree->GetScale().y_;
+
+		Billboard* billboard = billboards->GetBillboard(i);
+		billboard->position_ = tree->GetPosition() + Vector3(0.0f, variant->height_ * scale, 0.0f);
+		billboard->size_ = variant->size_ * scale;
+		billboard->uv_ = variant->uv_;
+		billboard->color_ = Color::WHITE;
+		billboard->rotation_ = 0.0f;
+		billboard->enabled_ = false;
+		group.states_[i] = TREE_MODEL;
+	}
+	billboards->Commit();
+
+	group.billboards_ = billboards;
+	groups_.Push(group);
+}
+
+void TreeImpostors::Update(const Vector3& cameraPosition)
+{
+	numImpostors_ = 0;
+
+	for (unsigned i = 0; i < groups_.Size();)
+	{
+		Group& group = groups_[i];
+		BillboardSet* billboards = group.billboards_;
+		// The segment was deleted together with its trees
+		if (!billboards)
+		{
+			groups_.Erase(i);
+			continue;
+		}
+
+		bool changed = false;
+		for (unsigned j = 0; j < group.trees_.Size(); ++j)
+		{
+			Node* tree = group.trees_[j];
+			unsigned char current = group.states_[j];
+			float distance = (tree->GetWorldPosition() - cameraPosition).Length();
+
+			// A tree has to cross a boundary by the margin to change its state
+			unsigned char state;
+			if (distance > cullDistance_ + (current == TREE_HIDDEN ? -IMPOSTOR_HYSTERESIS : IMPOSTOR_HYSTERESIS))
+				state = TREE_HIDDEN;
+			else if (distance > impostorDistance_ + (current == TREE_MODEL ? IMPOSTOR_HYSTERESIS : -IMPOSTOR_HYSTERESIS))
+				state = TREE_IMPOSTOR;
+			else
+				state = TREE_MODEL;
+
+			if (state != current)
+			{
+				group.states_[j] = state;
+				tree->SetEnabled(state == TREE_MODEL);
+				billboards->GetBillboard(j)->enabled_ = state == TREE_IMPOSTOR;
+				changed = true;
+			}
+			if (state == TREE_IMPOSTOR)
+				++numImpostors_;
+		}
+
+		if (changed)
+			billboards->Commit();
+		++i;
+	}
+}
+
+void TreeImpostors::SetDistances(float impostorDistance, float cullDistance)
+{
+	impostorDistance_ = impostorDistance;
+	cullDistance_ = Max(cullDistance, impostorDistance);
+}
+
+const TreeImpostors::Variant* TreeImpostors::GetVariant(Node* tree) const
+{
+	StaticModel* model = tree->GetComponent<StaticModel>();
+	if (!model)
+		return 0;
+
+	for (unsigned i = 0; i < variants_.Size(); ++i)
+	{
+		StaticModel* prototypeModel = variants_[i].prototype_->GetComponent<StaticModel>();
+		if (prototypeModel && prototypeModel->GetModel() == model->GetModel())
+			return &variants_[i];
+	}
+	return 0;
+}
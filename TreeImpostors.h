@@ -0,0 +1,93 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+
+#include "Spawner.h"
+
+namespace Urho3D
+{
+	class BillboardSet;
+	class Material;
+	class Node;
+	class Scene;
+	class Texture2D;
+}
+
+using namespace Urho3D;
+
+/// Default camera distance beyond which trees are drawn as impostors.
+const float IMPOSTOR_DISTANCE = 50.0f;
+/// Size of one atlas cell in pixels.
+const int IMPOSTOR_CELL_SIZE = 256;
+
+/// Billboard impostors for the roadside trees.
+/// Each tree variant is rendered once into a cell of an atlas texture. Every segment gets one BillboardSet with a
+/// billboard per tree, and trees past the impostor distance from the camera are swapped for their billboard, so the
+/// distant trees of a segment cost a single draw call. Trees past the cull distance are not drawn at all.
+class TreeImpostors : public Object
+{
+	URHO3D_OBJECT(TreeImpostors, Object);
+
+public:
+	/// Construct.
+	TreeImpostors(Context* context);
+	/// Destruct.
+	~TreeImpostors();
+
+	/// Render the tree prototypes of the spawner into the atlas. The atlas is filled during the next rendered frame.
+	void Create(Spawner* spawner);
+	/// Create the impostor billboards for the trees of a segment.
+	void AddSegment(Node* segment);
+	/// Swap trees and impostors by distance from the camera.
+	void Update(const Vector3& cameraPosition);
+	/// Set the distance where trees become impostors and the distance where they are hidden.
+	void SetDistances(float impostorDistance, float cullDistance);
+
+	/// Return number of trees currently drawn as impostors.
+	unsigned GetNumImpostors() const { return numImpostors_; }
+
+private:
+	/// Impostor variant of a tree prototype.
+	struct Variant
+	{
+		/// Prototype the variant was rendered from.
+		Node* prototype_;
+		/// Texture coordinates in the atlas.
+		Rect uv_;
+		/// Half size of the billboard at scale 1.
+		Vector2 size_;
+		/// Billboard center above the tree origin at scale 1.
+		float height_;
+	};
+
+	/// Trees of one segment and their billboards.
+	struct Group
+	{
+		/// Billboards, one per tree in the same order.
+		WeakPtr<BillboardSet> billboards_;
+		/// Tree nodes, children of the same segment as the billboards.
+		PODVector<Node*> trees_;
+		/// How each tree is drawn.
+		PODVector<unsigned char> states_;
+	};
+
+	/// Return the variant of a spawned tree, or null if unknown.
+	const Variant* GetVariant(Node* tree) const;
+
+	/// Scene the variants are rendered from.
+	SharedPtr<Scene> scene_;
+	/// Atlas texture.
+	SharedPtr<Texture2D> atlas_;
+	/// Billboard material.
+	SharedPtr<Material> material_;
+	/// Variants.
+	PODVector<Variant> variants_;
+	/// Segment groups.
+	Vector<Group> groups_;
+	/// Distance where trees become impostors.
+	float impostorDistance_;
+	/// Distance where trees are hidden.
+	float cullDistance_;
+	/// Number of trees drawn as impostors.
+	unsigned numImpostors_;
+};